@@ -0,0 +1,139 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2018 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <glib.h>
+
+#include "acb-backend.h"
+#include "acb-spawn.h"
+
+static gboolean
+acb_backend_path_has_file (const gchar *path, const gchar *filename)
+{
+	g_autofree gchar *tmp = g_build_filename (path, filename, NULL);
+	return g_file_test (tmp, G_FILE_TEST_EXISTS);
+}
+
+/* meson first, as some projects ship both during a port */
+AcbBackendKind
+acb_backend_detect (const gchar *path)
+{
+	if (acb_backend_path_has_file (path, "meson.build"))
+		return ACB_BACKEND_KIND_MESON;
+	if (acb_backend_path_has_file (path, "CMakeLists.txt"))
+		return ACB_BACKEND_KIND_CMAKE;
+	if (acb_backend_path_has_file (path, "configure.ac") ||
+	    acb_backend_path_has_file (path, "configure.in") ||
+	    acb_backend_path_has_file (path, "Makefile"))
+		return ACB_BACKEND_KIND_AUTOTOOLS;
+	return ACB_BACKEND_KIND_UNKNOWN;
+}
+
+const gchar *
+acb_backend_kind_to_string (AcbBackendKind kind)
+{
+	if (kind == ACB_BACKEND_KIND_AUTOTOOLS)
+		return "autotools";
+	if (kind == ACB_BACKEND_KIND_MESON)
+		return "meson";
+	if (kind == ACB_BACKEND_KIND_CMAKE)
+		return "cmake";
+	return "unknown";
+}
+
+/* where the commands are run, and where config.h is found */
+gchar *
+acb_backend_get_build_dir (AcbBackendKind kind, const gchar *path)
+{
+	if (kind == ACB_BACKEND_KIND_MESON || kind == ACB_BACKEND_KIND_CMAKE)
+		return g_build_filename (path, "build", NULL);
+	return g_strdup (path);
+}
+
+/* the jobserver in MAKEFLAGS sets the parallelism when there are slots,
+ * but ninja only reads it from 1.13 so older versions get the slot count */
+gchar *
+acb_backend_get_make_cmdline (AcbBackendKind kind, guint slots)
+{
+	gboolean has_jobserver = slots > 0;
+	if (kind == ACB_BACKEND_KIND_MESON) {
+		if (has_jobserver &&
+		    acb_spawn_get_version ("ninja") >= ACB_SPAWN_VERSION (1, 13))
+			return g_strdup ("ninja");
+		return g_strdup_printf ("ninja -j%u",
+					has_jobserver ? slots : g_get_num_processors ());
+	}
+	if (kind == ACB_BACKEND_KIND_CMAKE) {
+		if (has_jobserver)
+			return g_strdup ("cmake --build .");
+		return g_strdup_printf ("cmake --build . --parallel %u",
+					g_get_num_processors ());
+	}
+	if (has_jobserver)
+		return g_strdup ("make");
+	return g_strdup_printf ("make -j%u", g_get_num_processors ());
+}
+
+gchar *
+acb_backend_get_clean_cmdline (AcbBackendKind kind)
+{
+	if (kind == ACB_BACKEND_KIND_MESON)
+		return g_strdup ("ninja clean");
+	if (kind == ACB_BACKEND_KIND_CMAKE)
+		return g_strdup ("cmake --build . --target clean");
+	return g_strdup ("make clean");
+}
+
+/* the basename is the tarball name without any extension */
+gchar *
+acb_backend_get_dist_cmdline (AcbBackendKind kind,
+			      const gchar *basename,
+			      gboolean run_tests)
+{
+	if (kind == ACB_BACKEND_KIND_MESON) {
+		/* --formats and --no-tests are new in 0.52 */
+		if (acb_spawn_get_version ("meson") < ACB_SPAWN_VERSION (0, 52))
+			return g_strdup ("ninja dist");
+		if (run_tests)
+			return g_strdup ("meson dist --formats xztar");
+		return g_strdup ("meson dist --no-tests --formats xztar");
+	}
+	if (kind == ACB_BACKEND_KIND_CMAKE) {
+		return g_strdup_printf ("cpack --config CPackSourceConfig.cmake -G TXZ "
+					"-D CPACK_SOURCE_PACKAGE_FILE_NAME=%s",
+					basename);
+	}
+	return g_strdup ("make dist");
+}
+
+/* where the tarball ends up */
+gchar *
+acb_backend_get_dist_dir (AcbBackendKind kind, const gchar *path)
+{
+	if (kind == ACB_BACKEND_KIND_MESON)
+		return g_build_filename (path, "build", "meson-dist", NULL);
+	if (kind == ACB_BACKEND_KIND_CMAKE)
+		return g_build_filename (path, "build", NULL);
+	return g_strdup (path);
+}
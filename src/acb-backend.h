@@ -0,0 +1,52 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2018 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __ACB_BACKEND_H
+#define __ACB_BACKEND_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef enum {
+	ACB_BACKEND_KIND_UNKNOWN,
+	ACB_BACKEND_KIND_AUTOTOOLS,
+	ACB_BACKEND_KIND_MESON,
+	ACB_BACKEND_KIND_CMAKE,
+	ACB_BACKEND_KIND_LAST
+} AcbBackendKind;
+
+AcbBackendKind	 acb_backend_detect			(const gchar		*path);
+const gchar	*acb_backend_kind_to_string		(AcbBackendKind		 kind);
+gchar		*acb_backend_get_build_dir		(AcbBackendKind		 kind,
+							 const gchar		*path);
+gchar		*acb_backend_get_make_cmdline		(AcbBackendKind		 kind,
+							 guint			 slots);
+gchar		*acb_backend_get_clean_cmdline		(AcbBackendKind		 kind);
+gchar		*acb_backend_get_dist_cmdline		(AcbBackendKind		 kind,
+							 const gchar		*basename,
+							 gboolean		 run_tests);
+gchar		*acb_backend_get_dist_dir		(AcbBackendKind		 kind,
+							 const gchar		*path);
+
+G_END_DECLS
+
+#endif /* __ACB_BACKEND_H */
@@ -0,0 +1,153 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2018 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <glib.h>
+
+#include "acb-ccache.h"
+
+typedef struct
+{
+	gchar			*directory;
+	gchar			*max_size;
+} AcbCcachePrivate;
+
+G_DEFINE_TYPE_WITH_PRIVATE (AcbCcache, acb_ccache, G_TYPE_OBJECT)
+
+#define GET_PRIVATE(o) (acb_ccache_get_instance_private (o))
+
+gboolean
+acb_ccache_set_from_defaults (AcbCcache *ccache, GKeyFile *defaults, GError **error)
+{
+	AcbCcachePrivate *priv = GET_PRIVATE (ccache);
+	g_autofree gchar *max_size = NULL;
+
+	g_return_val_if_fail (ACB_IS_CCACHE (ccache), FALSE);
+
+	/* shared by every project, and ccache trims it to the size itself */
+	max_size = g_key_file_get_string (defaults, "defaults", "CcacheMaxSize", NULL);
+	if (max_size != NULL) {
+		g_free (priv->max_size);
+		priv->max_size = g_steal_pointer (&max_size);
+	}
+	if (g_mkdir_with_parents (priv->directory, 0755) != 0) {
+		g_set_error (error, 1, 0, "failed to create %s", priv->directory);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/* the statslog is appended to for each compile, and is per-project */
+gchar **
+acb_ccache_add_environ (AcbCcache *ccache, gchar **envp, const gchar *statslog)
+{
+	AcbCcachePrivate *priv = GET_PRIVATE (ccache);
+
+	g_return_val_if_fail (ACB_IS_CCACHE (ccache), NULL);
+
+	envp = g_environ_setenv (envp, "CCACHE_DIR", priv->directory, TRUE);
+	envp = g_environ_setenv (envp, "CCACHE_MAXSIZE", priv->max_size, TRUE);
+	envp = g_environ_setenv (envp, "CCACHE_BASEDIR", g_get_home_dir (), TRUE);
+	envp = g_environ_setenv (envp, "CCACHE_STATSLOG", statslog, TRUE);
+	envp = g_environ_setenv (envp, "CC", "ccache gcc", FALSE);
+	envp = g_environ_setenv (envp, "CXX", "ccache g++", FALSE);
+	return envp;
+}
+
+/* ccache 4 also logs storage counters such as "local_storage_hit" for each
+ * compile, so only the result of the lookup itself is counted */
+gboolean
+acb_ccache_get_stats (const gchar *statslog, guint *hits, guint *misses)
+{
+	const gchar *keys_hit[] = { "direct_cache_hit",
+				    "preprocessed_cache_hit",
+				    "cache hit (direct)",
+				    "cache hit (preprocessed)",
+				    NULL };
+	const gchar *keys_miss[] = { "cache_miss",
+				     "cache miss",
+				     NULL };
+	guint i;
+	g_autofree gchar *data = NULL;
+	g_auto(GStrv) lines = NULL;
+
+	*hits = 0;
+	*misses = 0;
+	if (!g_file_get_contents (statslog, &data, NULL, NULL))
+		return FALSE;
+	lines = g_strsplit (data, "\n", -1);
+	for (i = 0; lines[i] != NULL; i++) {
+		const gchar *key = g_strstrip (lines[i]);
+		if (key[0] == '#')
+			continue;
+		if (g_strv_contains (keys_miss, key))
+			(*misses)++;
+		else if (g_strv_contains (keys_hit, key))
+			(*hits)++;
+	}
+	return TRUE;
+}
+
+static void
+acb_ccache_finalize (GObject *object)
+{
+	AcbCcache *ccache;
+	AcbCcachePrivate *priv;
+
+	g_return_if_fail (object != NULL);
+	g_return_if_fail (ACB_IS_CCACHE (object));
+	ccache = ACB_CCACHE (object);
+	priv = GET_PRIVATE (ccache);
+
+	g_free (priv->directory);
+	g_free (priv->max_size);
+
+	G_OBJECT_CLASS (acb_ccache_parent_class)->finalize (object);
+}
+
+static void
+acb_ccache_class_init (AcbCcacheClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->finalize = acb_ccache_finalize;
+}
+
+static void
+acb_ccache_init (AcbCcache *ccache)
+{
+	AcbCcachePrivate *priv = GET_PRIVATE (ccache);
+	priv->directory = g_build_filename (g_get_user_cache_dir (),
+					    "autocodebuild",
+					    "ccache",
+					    NULL);
+	priv->max_size = g_strdup ("5G");
+}
+
+AcbCcache *
+acb_ccache_new (void)
+{
+	AcbCcache *ccache;
+	ccache = g_object_new (ACB_TYPE_CCACHE, NULL);
+	return ACB_CCACHE (ccache);
+}
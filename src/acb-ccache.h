@@ -0,0 +1,50 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2018 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __ACB_CCACHE_H
+#define __ACB_CCACHE_H
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+#define ACB_TYPE_CCACHE (acb_ccache_get_type ())
+G_DECLARE_DERIVABLE_TYPE (AcbCcache, acb_ccache, ACB, CCACHE, GObject)
+
+struct _AcbCcacheClass
+{
+	GObjectClass		parent_class;
+};
+
+AcbCcache	*acb_ccache_new				(void);
+gboolean	 acb_ccache_set_from_defaults		(AcbCcache		*ccache,
+							 GKeyFile		*defaults,
+							 GError			**error);
+gchar		**acb_ccache_add_environ		(AcbCcache		*ccache,
+							 gchar			**envp,
+							 const gchar		*statslog);
+gboolean	 acb_ccache_get_stats			(const gchar		*statslog,
+							 guint			*hits,
+							 guint			*misses);
+
+G_END_DECLS
+
+#endif /* __ACB_CCACHE_H */
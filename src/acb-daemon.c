@@ -0,0 +1,406 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2018 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <glib.h>
+
+#include "acb-daemon.h"
+#include "acb-repo.h"
+#include "acb-spawn.h"
+#include "acb-watch.h"
+
+typedef struct
+{
+	GMainLoop		*loop;
+	AcbWatch		*watch;
+	AcbSchedulerFlags	 flags;
+	guint			 jobs;
+	AcbLoad			*load;
+	AcbJobserver		*jobserver;
+	AcbManifest		*manifest;
+	AcbProbe		*probe;
+	AcbPrefetch		*prefetch;	/* or NULL */
+	GPtrArray		*repos;		/* of gchar*, or NULL */
+	GPtrArray		*projects;	/* of AcbProject */
+	GPtrArray		*queue;		/* of AcbProject, changed */
+	GPtrArray		*fetched;	/* of AcbProject, new upstream commits */
+	GPtrArray		*batch;		/* of AcbProject, being built */
+	AcbScheduler		*scheduler;	/* for the batch */
+	GThread			*thread;	/* running the scheduler */
+} AcbDaemonPrivate;
+
+G_DEFINE_TYPE_WITH_PRIVATE (AcbDaemon, acb_daemon, G_TYPE_OBJECT)
+
+#define GET_PRIVATE(o) (acb_daemon_get_instance_private (o))
+
+void
+acb_daemon_set_flags (AcbDaemon *daemon, AcbSchedulerFlags flags)
+{
+	AcbDaemonPrivate *priv = GET_PRIVATE (daemon);
+	g_return_if_fail (ACB_IS_DAEMON (daemon));
+	priv->flags = flags;
+}
+
+void
+acb_daemon_set_jobs (AcbDaemon *daemon, guint jobs)
+{
+	AcbDaemonPrivate *priv = GET_PRIVATE (daemon);
+	g_return_if_fail (ACB_IS_DAEMON (daemon));
+	priv->jobs = jobs;
+}
+
+void
+acb_daemon_set_load (AcbDaemon *daemon, AcbLoad *load)
+{
+	AcbDaemonPrivate *priv = GET_PRIVATE (daemon);
+	g_return_if_fail (ACB_IS_DAEMON (daemon));
+	g_set_object (&priv->load, load);
+}
+
+void
+acb_daemon_set_jobserver (AcbDaemon *daemon, AcbJobserver *jobserver)
+{
+	AcbDaemonPrivate *priv = GET_PRIVATE (daemon);
+	g_return_if_fail (ACB_IS_DAEMON (daemon));
+	g_set_object (&priv->jobserver, jobserver);
+}
+
+void
+acb_daemon_set_manifest (AcbDaemon *daemon, AcbManifest *manifest)
+{
+	AcbDaemonPrivate *priv = GET_PRIVATE (daemon);
+	g_return_if_fail (ACB_IS_DAEMON (daemon));
+	g_set_object (&priv->manifest, manifest);
+}
+
+void
+acb_daemon_set_probe (AcbDaemon *daemon, AcbProbe *probe)
+{
+	AcbDaemonPrivate *priv = GET_PRIVATE (daemon);
+	g_return_if_fail (ACB_IS_DAEMON (daemon));
+	g_set_object (&priv->probe, probe);
+}
+
+/* keeps the remotes fetched so the update stage stays local */
+void
+acb_daemon_set_prefetch (AcbDaemon *daemon, AcbPrefetch *prefetch)
+{
+	AcbDaemonPrivate *priv = GET_PRIVATE (daemon);
+	g_return_if_fail (ACB_IS_DAEMON (daemon));
+	g_set_object (&priv->prefetch, prefetch);
+}
+
+/* the repo directories to refresh after packages have been built */
+void
+acb_daemon_set_repos (AcbDaemon *daemon, GPtrArray *repos)
+{
+	AcbDaemonPrivate *priv = GET_PRIVATE (daemon);
+	g_return_if_fail (ACB_IS_DAEMON (daemon));
+	if (priv->repos != NULL)
+		g_ptr_array_unref (priv->repos);
+	priv->repos = repos != NULL ? g_ptr_array_ref (repos) : NULL;
+}
+
+void
+acb_daemon_add_project (AcbDaemon *daemon, AcbProject *project)
+{
+	AcbDaemonPrivate *priv = GET_PRIVATE (daemon);
+	g_return_if_fail (ACB_IS_DAEMON (daemon));
+	g_return_if_fail (ACB_IS_PROJECT (project));
+	g_ptr_array_add (priv->projects, g_object_ref (project));
+}
+
+/* the releases have been bumped, and the repos need new metadata */
+static void
+acb_daemon_batch_save (AcbDaemon *daemon)
+{
+	AcbDaemonPrivate *priv = GET_PRIVATE (daemon);
+	guint i;
+	g_autoptr(GError) error = NULL;
+
+	if (priv->manifest != NULL && !acb_manifest_save (priv->manifest, &error)) {
+		g_warning ("cannot save projects: %s", error->message);
+		g_clear_error (&error);
+	}
+	if (priv->probe != NULL && !acb_probe_save (priv->probe, &error)) {
+		g_warning ("cannot save probe cache: %s", error->message);
+		g_clear_error (&error);
+	}
+	if (priv->repos == NULL || (priv->flags & ACB_SCHEDULER_FLAG_BUILD) == 0)
+		return;
+	for (i = 0; i < priv->repos->len; i++) {
+		const gchar *repo = g_ptr_array_index (priv->repos, i);
+		if (!acb_repo_publish (repo, &error)) {
+			g_warning ("cannot publish: %s", error->message);
+			g_clear_error (&error);
+		}
+	}
+}
+
+static void acb_daemon_batch_start (AcbDaemon *daemon);
+
+/* back in the main loop */
+static gboolean
+acb_daemon_batch_done_cb (gpointer user_data)
+{
+	AcbDaemon *daemon = ACB_DAEMON (user_data);
+	AcbDaemonPrivate *priv = GET_PRIVATE (daemon);
+	guint i;
+
+	g_thread_join (priv->thread);
+	priv->thread = NULL;
+	g_clear_object (&priv->scheduler);
+	for (i = 0; i < priv->batch->len; i++) {
+		AcbProject *project = g_ptr_array_index (priv->batch, i);
+		acb_watch_set_paused (priv->watch, project, FALSE);
+		if (priv->prefetch != NULL)
+			acb_prefetch_set_paused (priv->prefetch, project, FALSE);
+	}
+	g_ptr_array_set_size (priv->batch, 0);
+
+	/* things changed while we were busy */
+	acb_daemon_batch_start (daemon);
+	return G_SOURCE_REMOVE;
+}
+
+static gpointer
+acb_daemon_batch_thread_cb (gpointer user_data)
+{
+	AcbDaemon *daemon = ACB_DAEMON (user_data);
+	AcbDaemonPrivate *priv = GET_PRIVATE (daemon);
+	g_autoptr(GError) error = NULL;
+
+	if (!acb_scheduler_run (priv->scheduler, &error))
+		g_warning ("cannot process projects: %s", error->message);
+	acb_scheduler_print_summary (priv->scheduler);
+	acb_daemon_batch_save (daemon);
+	g_idle_add (acb_daemon_batch_done_cb, daemon);
+	return NULL;
+}
+
+/* a project being fetched waits for the next batch */
+static void
+acb_daemon_batch_add_queue (AcbDaemon *daemon, GPtrArray *queue)
+{
+	AcbDaemonPrivate *priv = GET_PRIVATE (daemon);
+	guint i;
+	g_autoptr(GPtrArray) waiting = NULL;
+
+	waiting = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	for (i = 0; i < queue->len; i++) {
+		AcbProject *project = g_ptr_array_index (queue, i);
+		if (priv->prefetch != NULL &&
+		    acb_prefetch_get_busy (priv->prefetch, project))
+			g_ptr_array_add (waiting, g_object_ref (project));
+		else
+			g_ptr_array_add (priv->batch, g_object_ref (project));
+	}
+	g_ptr_array_set_size (queue, 0);
+	for (i = 0; i < waiting->len; i++)
+		g_ptr_array_add (queue, g_object_ref (g_ptr_array_index (waiting, i)));
+}
+
+/* everything that changed is built together, so the depends are honoured */
+static void
+acb_daemon_batch_start (AcbDaemon *daemon)
+{
+	AcbDaemonPrivate *priv = GET_PRIVATE (daemon);
+	AcbSchedulerFlags flags;
+	guint i;
+
+	if (priv->thread != NULL)
+		return;
+	if (acb_spawn_is_shutdown ())
+		return;
+
+	/* new upstream commits are applied first, and local edits are only
+	 * ever made or built as rebasing a dirty tree would fail */
+	if (priv->fetched->len > 0) {
+		acb_daemon_batch_add_queue (daemon, priv->fetched);
+		for (i = 0; i < priv->batch->len; i++)
+			g_ptr_array_remove (priv->queue, g_ptr_array_index (priv->batch, i));
+		flags = priv->flags;
+	} else {
+		acb_daemon_batch_add_queue (daemon, priv->queue);
+		flags = priv->flags & ~ACB_SCHEDULER_FLAG_UPDATE;
+	}
+	if (priv->batch->len == 0)
+		return;
+
+	priv->scheduler = acb_scheduler_new ();
+	acb_scheduler_set_flags (priv->scheduler, flags);
+	acb_scheduler_set_jobs (priv->scheduler, priv->jobs);
+	if (priv->load != NULL)
+		acb_scheduler_set_load (priv->scheduler, priv->load);
+	if (priv->jobserver != NULL)
+		acb_scheduler_set_jobserver (priv->scheduler, priv->jobserver);
+	for (i = 0; i < priv->batch->len; i++) {
+		AcbProject *project = g_ptr_array_index (priv->batch, i);
+		acb_watch_set_paused (priv->watch, project, TRUE);
+		if (priv->prefetch != NULL)
+			acb_prefetch_set_paused (priv->prefetch, project, TRUE);
+		acb_project_reset (project);
+		acb_scheduler_add_project (priv->scheduler, project);
+	}
+	priv->thread = g_thread_new ("daemon", acb_daemon_batch_thread_cb, daemon);
+}
+
+static void
+acb_daemon_project_changed_cb (AcbProject *project, gpointer user_data)
+{
+	AcbDaemon *daemon = ACB_DAEMON (user_data);
+	AcbDaemonPrivate *priv = GET_PRIVATE (daemon);
+
+	if (!g_ptr_array_find (priv->queue, project, NULL))
+		g_ptr_array_add (priv->queue, g_object_ref (project));
+	acb_daemon_batch_start (daemon);
+}
+
+/* anything held back while it was being fetched can now be built */
+static void
+acb_daemon_project_fetched_cb (AcbProject *project, gboolean fetched, gpointer user_data)
+{
+	AcbDaemon *daemon = ACB_DAEMON (user_data);
+	AcbDaemonPrivate *priv = GET_PRIVATE (daemon);
+
+	if (fetched && !g_ptr_array_find (priv->fetched, project, NULL))
+		g_ptr_array_add (priv->fetched, g_object_ref (project));
+	acb_daemon_batch_start (daemon);
+}
+
+/* the signal handler cannot touch the main loop itself */
+static gboolean
+acb_daemon_shutdown_cb (gpointer user_data)
+{
+	AcbDaemon *daemon = ACB_DAEMON (user_data);
+	AcbDaemonPrivate *priv = GET_PRIVATE (daemon);
+	if (!acb_spawn_is_shutdown ())
+		return G_SOURCE_CONTINUE;
+	g_main_loop_quit (priv->loop);
+	return G_SOURCE_REMOVE;
+}
+
+/* only returns when asked to shut down */
+gboolean
+acb_daemon_run (AcbDaemon *daemon, GError **error)
+{
+	AcbDaemonPrivate *priv = GET_PRIVATE (daemon);
+	guint i;
+
+	g_return_val_if_fail (ACB_IS_DAEMON (daemon), FALSE);
+
+	if (!acb_watch_setup (priv->watch, error))
+		return FALSE;
+	acb_watch_set_func (priv->watch, acb_daemon_project_changed_cb, daemon);
+	for (i = 0; i < priv->projects->len; i++) {
+		AcbProject *project = g_ptr_array_index (priv->projects, i);
+		if (acb_project_get_disabled (project))
+			continue;
+		if (!acb_watch_add_project (priv->watch, project, error))
+			return FALSE;
+	}
+	g_print ("Watching %u projects for changes\n", priv->projects->len);
+
+	/* new upstream commits are updated, made and built */
+	if (priv->prefetch != NULL) {
+		acb_prefetch_set_func (priv->prefetch, acb_daemon_project_fetched_cb, daemon);
+		if (!acb_prefetch_start (priv->prefetch, error))
+			return FALSE;
+	}
+
+	g_timeout_add_seconds (1, acb_daemon_shutdown_cb, daemon);
+	g_main_loop_run (priv->loop);
+	if (priv->prefetch != NULL)
+		acb_prefetch_stop (priv->prefetch);
+
+	/* the running commands have already been killed */
+	if (priv->thread != NULL) {
+		g_thread_join (priv->thread);
+		priv->thread = NULL;
+	}
+	return TRUE;
+}
+
+static void
+acb_daemon_finalize (GObject *object)
+{
+	AcbDaemon *daemon;
+	AcbDaemonPrivate *priv;
+
+	g_return_if_fail (object != NULL);
+	g_return_if_fail (ACB_IS_DAEMON (object));
+	daemon = ACB_DAEMON (object);
+	priv = GET_PRIVATE (daemon);
+
+	g_main_loop_unref (priv->loop);
+	g_object_unref (priv->watch);
+	if (priv->load != NULL)
+		g_object_unref (priv->load);
+	if (priv->jobserver != NULL)
+		g_object_unref (priv->jobserver);
+	if (priv->manifest != NULL)
+		g_object_unref (priv->manifest);
+	if (priv->probe != NULL)
+		g_object_unref (priv->probe);
+	if (priv->prefetch != NULL)
+		g_object_unref (priv->prefetch);
+	if (priv->repos != NULL)
+		g_ptr_array_unref (priv->repos);
+	if (priv->scheduler != NULL)
+		g_object_unref (priv->scheduler);
+	g_ptr_array_unref (priv->projects);
+	g_ptr_array_unref (priv->queue);
+	g_ptr_array_unref (priv->fetched);
+	g_ptr_array_unref (priv->batch);
+
+	G_OBJECT_CLASS (acb_daemon_parent_class)->finalize (object);
+}
+
+static void
+acb_daemon_class_init (AcbDaemonClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->finalize = acb_daemon_finalize;
+}
+
+static void
+acb_daemon_init (AcbDaemon *daemon)
+{
+	AcbDaemonPrivate *priv = GET_PRIVATE (daemon);
+	priv->loop = g_main_loop_new (NULL, FALSE);
+	priv->watch = acb_watch_new ();
+	priv->flags = ACB_SCHEDULER_FLAG_MAKE;
+	priv->projects = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	priv->queue = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	priv->fetched = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	priv->batch = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+}
+
+AcbDaemon *
+acb_daemon_new (void)
+{
+	AcbDaemon *daemon;
+	daemon = g_object_new (ACB_TYPE_DAEMON, NULL);
+	return ACB_DAEMON (daemon);
+}
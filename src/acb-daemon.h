@@ -0,0 +1,69 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2018 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __ACB_DAEMON_H
+#define __ACB_DAEMON_H
+
+#include <glib-object.h>
+
+#include "acb-jobserver.h"
+#include "acb-load.h"
+#include "acb-manifest.h"
+#include "acb-prefetch.h"
+#include "acb-probe.h"
+#include "acb-project.h"
+#include "acb-scheduler.h"
+
+G_BEGIN_DECLS
+
+#define ACB_TYPE_DAEMON (acb_daemon_get_type ())
+G_DECLARE_DERIVABLE_TYPE (AcbDaemon, acb_daemon, ACB, DAEMON, GObject)
+
+struct _AcbDaemonClass
+{
+	GObjectClass		parent_class;
+};
+
+AcbDaemon	*acb_daemon_new				(void);
+void		 acb_daemon_set_flags			(AcbDaemon		*daemon,
+							 AcbSchedulerFlags	 flags);
+void		 acb_daemon_set_jobs			(AcbDaemon		*daemon,
+							 guint			 jobs);
+void		 acb_daemon_set_load			(AcbDaemon		*daemon,
+							 AcbLoad		*load);
+void		 acb_daemon_set_jobserver		(AcbDaemon		*daemon,
+							 AcbJobserver		*jobserver);
+void		 acb_daemon_set_manifest		(AcbDaemon		*daemon,
+							 AcbManifest		*manifest);
+void		 acb_daemon_set_probe			(AcbDaemon		*daemon,
+							 AcbProbe		*probe);
+void		 acb_daemon_set_prefetch		(AcbDaemon		*daemon,
+							 AcbPrefetch		*prefetch);
+void		 acb_daemon_set_repos			(AcbDaemon		*daemon,
+							 GPtrArray		*repos);
+void		 acb_daemon_add_project			(AcbDaemon		*daemon,
+							 AcbProject		*project);
+gboolean	 acb_daemon_run				(AcbDaemon		*daemon,
+							 GError			**error);
+
+G_END_DECLS
+
+#endif /* __ACB_DAEMON_H */
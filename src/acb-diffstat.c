@@ -0,0 +1,245 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2018 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+
+#include "acb-diffstat.h"
+
+/* the widest the +++--- histogram can be */
+#define ACB_DIFFSTAT_BAR_WIDTH		40
+
+typedef struct {
+	gchar			*filename;
+	guint			 insertions;
+	guint			 deletions;
+	gboolean		 binary;
+} AcbDiffstatFile;
+
+typedef struct
+{
+	GPtrArray		*files;		/* of AcbDiffstatFile */
+	AcbDiffstatFile		*current;
+	guint			 hunk_old;	/* lines left in this hunk */
+	guint			 hunk_new;
+} AcbDiffstatPrivate;
+
+G_DEFINE_TYPE_WITH_PRIVATE (AcbDiffstat, acb_diffstat, G_TYPE_OBJECT)
+
+#define GET_PRIVATE(o) (acb_diffstat_get_instance_private (o))
+
+static void
+acb_diffstat_file_free (AcbDiffstatFile *file)
+{
+	g_free (file->filename);
+	g_free (file);
+}
+
+/* parses the line counts from "@@ -1,7 +1,6 @@", where a count of 1 is implied */
+static void
+acb_diffstat_parse_hunk (AcbDiffstat *diffstat, const gchar *line)
+{
+	AcbDiffstatPrivate *priv = GET_PRIVATE (diffstat);
+	const gchar *tmp;
+	gchar *endptr = NULL;
+
+	priv->hunk_old = 0;
+	priv->hunk_new = 0;
+	tmp = strchr (line, '-');
+	if (tmp == NULL)
+		return;
+	strtoul (tmp + 1, &endptr, 10);
+	priv->hunk_old = *endptr == ',' ? (guint) strtoul (endptr + 1, &endptr, 10) : 1;
+	tmp = strchr (endptr, '+');
+	if (tmp == NULL)
+		return;
+	strtoul (tmp + 1, &endptr, 10);
+	priv->hunk_new = *endptr == ',' ? (guint) strtoul (endptr + 1, NULL, 10) : 1;
+}
+
+/* called for each line of unified diff output as it is read */
+void
+acb_diffstat_add_line (AcbDiffstat *diffstat, const gchar *line)
+{
+	AcbDiffstatPrivate *priv = GET_PRIVATE (diffstat);
+
+	g_return_if_fail (ACB_IS_DIFFSTAT (diffstat));
+
+	/* inside a hunk, so the counts say what each line is */
+	if (priv->hunk_old > 0 || priv->hunk_new > 0) {
+		if (line[0] == '+' && priv->hunk_new > 0) {
+			priv->current->insertions++;
+			priv->hunk_new--;
+		} else if (line[0] == '-' && priv->hunk_old > 0) {
+			priv->current->deletions++;
+			priv->hunk_old--;
+		} else if (line[0] == ' ' || line[0] == '\0') {
+			if (priv->hunk_old > 0)
+				priv->hunk_old--;
+			if (priv->hunk_new > 0)
+				priv->hunk_new--;
+		}
+		return;
+	}
+
+	/* new file */
+	if (g_str_has_prefix (line, "diff ")) {
+		const gchar *tmp = strstr (line, " b/");
+		priv->current = g_new0 (AcbDiffstatFile, 1);
+		g_ptr_array_add (priv->files, priv->current);
+
+		/* binary files and pure renames have no ---/+++ lines */
+		if (g_str_has_prefix (line, "diff --git ") && tmp != NULL)
+			priv->current->filename = g_strdup (tmp + 3);
+		return;
+	}
+	if (priv->current == NULL)
+		return;
+
+	/* prefer the new name, unless it was deleted */
+	if (g_str_has_prefix (line, "--- ") && priv->current->filename == NULL) {
+		if (g_str_has_prefix (line, "--- a/"))
+			priv->current->filename = g_strdup (line + 6);
+		return;
+	}
+	if (g_str_has_prefix (line, "+++ ")) {
+		if (g_str_has_prefix (line, "+++ b/")) {
+			g_free (priv->current->filename);
+			priv->current->filename = g_strdup (line + 6);
+		}
+		return;
+	}
+	if (g_str_has_prefix (line, "@@ "))
+		acb_diffstat_parse_hunk (diffstat, line);
+	else if (g_str_has_prefix (line, "Binary files "))
+		priv->current->binary = TRUE;
+}
+
+guint
+acb_diffstat_get_files_changed (AcbDiffstat *diffstat)
+{
+	AcbDiffstatPrivate *priv = GET_PRIVATE (diffstat);
+	g_return_val_if_fail (ACB_IS_DIFFSTAT (diffstat), 0);
+	return priv->files->len;
+}
+
+/* in the same format as diffstat(1) */
+gchar *
+acb_diffstat_to_string (AcbDiffstat *diffstat)
+{
+	AcbDiffstatPrivate *priv = GET_PRIVATE (diffstat);
+	GString *str = g_string_new (NULL);
+	guint i;
+	guint files_changed = 0;
+	guint insertions = 0;
+	guint deletions = 0;
+	guint max_changes = 0;
+	guint max_filename = 0;
+
+	g_return_val_if_fail (ACB_IS_DIFFSTAT (diffstat), NULL);
+
+	for (i = 0; i < priv->files->len; i++) {
+		AcbDiffstatFile *file = g_ptr_array_index (priv->files, i);
+		if (file->filename == NULL)
+			continue;
+		max_changes = MAX (max_changes, file->insertions + file->deletions);
+		max_filename = MAX (max_filename, (guint) strlen (file->filename));
+	}
+	for (i = 0; i < priv->files->len; i++) {
+		AcbDiffstatFile *file = g_ptr_array_index (priv->files, i);
+		guint changes = file->insertions + file->deletions;
+		guint plus = file->insertions;
+		guint minus = file->deletions;
+		if (file->filename == NULL)
+			continue;
+
+		/* scale to fit */
+		if (max_changes > ACB_DIFFSTAT_BAR_WIDTH) {
+			plus = (guint) ((guint64) plus * ACB_DIFFSTAT_BAR_WIDTH / max_changes);
+			minus = (guint) ((guint64) minus * ACB_DIFFSTAT_BAR_WIDTH / max_changes);
+			if (plus == 0 && file->insertions > 0)
+				plus = 1;
+			if (minus == 0 && file->deletions > 0)
+				minus = 1;
+		}
+		files_changed++;
+		if (file->binary) {
+			g_string_append_printf (str, " %-*s | %5s\n",
+						(gint) max_filename, file->filename, "Bin");
+			continue;
+		}
+		g_string_append_printf (str, " %-*s | %5u ",
+					(gint) max_filename, file->filename, changes);
+		for (; plus > 0; plus--)
+			g_string_append_c (str, '+');
+		for (; minus > 0; minus--)
+			g_string_append_c (str, '-');
+		g_string_append_c (str, '\n');
+		insertions += file->insertions;
+		deletions += file->deletions;
+	}
+	g_string_append_printf (str, " %u files changed, %u insertions(+), %u deletions(-)",
+				files_changed, insertions, deletions);
+	return g_string_free (str, FALSE);
+}
+
+static void
+acb_diffstat_finalize (GObject *object)
+{
+	AcbDiffstat *diffstat;
+	AcbDiffstatPrivate *priv;
+
+	g_return_if_fail (object != NULL);
+	g_return_if_fail (ACB_IS_DIFFSTAT (object));
+	diffstat = ACB_DIFFSTAT (object);
+	priv = GET_PRIVATE (diffstat);
+
+	g_ptr_array_unref (priv->files);
+
+	G_OBJECT_CLASS (acb_diffstat_parent_class)->finalize (object);
+}
+
+static void
+acb_diffstat_class_init (AcbDiffstatClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->finalize = acb_diffstat_finalize;
+}
+
+static void
+acb_diffstat_init (AcbDiffstat *diffstat)
+{
+	AcbDiffstatPrivate *priv = GET_PRIVATE (diffstat);
+	priv->files = g_ptr_array_new_with_free_func ((GDestroyNotify) acb_diffstat_file_free);
+}
+
+AcbDiffstat *
+acb_diffstat_new (void)
+{
+	AcbDiffstat *diffstat;
+	diffstat = g_object_new (ACB_TYPE_DIFFSTAT, NULL);
+	return ACB_DIFFSTAT (diffstat);
+}
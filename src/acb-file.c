@@ -0,0 +1,302 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2018 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#ifdef HAVE_LINUX_FS_H
+#  include <linux/fs.h>
+#endif
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "acb-file.h"
+
+#define ACB_FILE_OWNER_NAME		".owner"
+
+/* seconds for the owner to be written after the directory is created */
+#define ACB_FILE_OWNER_GRACE		60
+
+static gboolean
+acb_file_write_all (gint fd, const gchar *buf, gsize len)
+{
+	while (len > 0) {
+		gssize wrote = write (fd, buf, len);
+		if (wrote < 0 && errno == EINTR)
+			continue;
+		if (wrote < 0)
+			return FALSE;
+		buf += wrote;
+		len -= (gsize) wrote;
+	}
+	return TRUE;
+}
+
+static gboolean
+acb_file_copy_stream (gint fd_src, gint fd_dest)
+{
+	gchar buf[65536];
+
+	for (;;) {
+		gssize len = read (fd_src, buf, sizeof (buf));
+		if (len < 0 && errno == EINTR)
+			continue;
+		if (len < 0)
+			return FALSE;
+		if (len == 0)
+			return TRUE;
+		if (!acb_file_write_all (fd_dest, buf, (gsize) len))
+			return FALSE;
+	}
+}
+
+/* copies in the kernel, or shares the extents on filesystems that can */
+static gboolean
+acb_file_copy_data (gint fd_src, gint fd_dest, goffset size)
+{
+#ifdef FICLONE
+	if (ioctl (fd_dest, FICLONE, fd_src) == 0) {
+		g_debug ("copied using a reflink");
+		return TRUE;
+	}
+#endif
+#ifdef HAVE_COPY_FILE_RANGE
+	while (size > 0) {
+		gssize len = copy_file_range (fd_src, NULL, fd_dest, NULL, (gsize) size, 0);
+		if (len < 0 && errno == EINTR)
+			continue;
+		if (len <= 0)
+			break;
+		size -= len;
+	}
+	if (size == 0)
+		return TRUE;
+	g_debug ("copy_file_range failed: %s", g_strerror (errno));
+#endif
+	return FALSE;
+}
+
+/* links to a new unique name, which is never unlinked before use */
+static gchar *
+acb_file_link_tmp (const gchar *src, const gchar *dest)
+{
+	guint i;
+
+	for (i = 0; i < 100; i++) {
+		g_autofree gchar *tmp = NULL;
+		tmp = g_strdup_printf ("%s.%06x", dest, g_random_int () & 0xffffff);
+		if (link (src, tmp) == 0)
+			return g_steal_pointer (&tmp);
+		if (errno != EEXIST) {
+			g_debug ("failed to hardlink %s: %s", src, g_strerror (errno));
+			return NULL;
+		}
+	}
+	return NULL;
+}
+
+/* the new file is only visible at dest once it is complete */
+gboolean
+acb_file_copy (const gchar *src,
+	       const gchar *dest,
+	       AcbFileCopyFlags flags,
+	       GError **error)
+{
+	GStatBuf st_src;
+	GStatBuf st_dir;
+	gboolean ret = FALSE;
+	gint fd_src = -1;
+	gint fd_tmp = -1;
+	g_autofree gchar *dirname = NULL;
+	g_autofree gchar *tmp = NULL;
+	g_autofree gchar *tmp_link = NULL;
+
+	g_return_val_if_fail (src != NULL, FALSE);
+	g_return_val_if_fail (dest != NULL, FALSE);
+
+	fd_src = g_open (src, O_RDONLY | O_CLOEXEC, 0);
+	if (fd_src < 0 || fstat (fd_src, &st_src) != 0) {
+		g_set_error (error, 1, 0, "failed to open %s: %s",
+			     src, g_strerror (errno));
+		goto out;
+	}
+	tmp = g_strdup_printf ("%s.XXXXXX", dest);
+	fd_tmp = g_mkstemp_full (tmp, O_RDWR | O_CLOEXEC, st_src.st_mode & 0777);
+	if (fd_tmp < 0) {
+		g_set_error (error, 1, 0, "failed to create %s: %s",
+			     tmp, g_strerror (errno));
+		g_clear_pointer (&tmp, g_free);
+		goto out;
+	}
+
+	/* a reflink, then copy_file_range() */
+	if (acb_file_copy_data (fd_src, fd_tmp, (goffset) st_src.st_size))
+		goto commit;
+
+	/* a hardlink costs nothing, but the file is then shared */
+	dirname = g_path_get_dirname (dest);
+	if ((flags & ACB_FILE_COPY_FLAG_ALLOW_HARDLINK) > 0 &&
+	    g_stat (dirname, &st_dir) == 0 &&
+	    st_dir.st_dev == st_src.st_dev) {
+		tmp_link = acb_file_link_tmp (src, dest);
+		if (tmp_link != NULL) {
+			g_debug ("copied using a hardlink");
+			if (g_rename (tmp_link, dest) != 0) {
+				g_set_error (error, 1, 0, "failed to rename %s: %s",
+					     tmp_link, g_strerror (errno));
+				g_unlink (tmp_link);
+				goto out;
+			}
+			ret = TRUE;
+			goto out;
+		}
+	}
+
+	/* the last resort, starting again from the beginning */
+	if (ftruncate (fd_tmp, 0) != 0 ||
+	    lseek (fd_src, 0, SEEK_SET) != 0 ||
+	    lseek (fd_tmp, 0, SEEK_SET) != 0 ||
+	    !acb_file_copy_stream (fd_src, fd_tmp)) {
+		g_set_error (error, 1, 0, "failed to copy %s: %s",
+			     src, g_strerror (errno));
+		goto out;
+	}
+commit:
+	if (g_rename (tmp, dest) != 0) {
+		g_set_error (error, 1, 0, "failed to rename %s: %s",
+			     tmp, g_strerror (errno));
+		goto out;
+	}
+	g_clear_pointer (&tmp, g_free);
+	ret = TRUE;
+out:
+	if (tmp != NULL)
+		g_unlink (tmp);
+	if (fd_tmp >= 0)
+		close (fd_tmp);
+	if (fd_src >= 0)
+		close (fd_src);
+	return ret;
+}
+
+/* symlinks are removed, never followed */
+gboolean
+acb_file_remove_tree (const gchar *path, GError **error)
+{
+	GStatBuf st;
+	const gchar *filename;
+	g_autoptr(GDir) dir = NULL;
+
+	g_return_val_if_fail (path != NULL, FALSE);
+
+	if (g_lstat (path, &st) != 0) {
+		if (errno == ENOENT)
+			return TRUE;
+		g_set_error (error, 1, 0, "failed to stat %s: %s",
+			     path, g_strerror (errno));
+		return FALSE;
+	}
+	if (S_ISDIR (st.st_mode)) {
+		dir = g_dir_open (path, 0, error);
+		if (dir == NULL)
+			return FALSE;
+		while ((filename = g_dir_read_name (dir))) {
+			g_autofree gchar *child = g_build_filename (path, filename, NULL);
+			if (!acb_file_remove_tree (child, error))
+				return FALSE;
+		}
+	}
+	if (g_remove (path) != 0) {
+		g_set_error (error, 1, 0, "failed to remove %s: %s",
+			     path, g_strerror (errno));
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/* written into a private directory so a later run knows if it is abandoned */
+gboolean
+acb_file_set_owner (const gchar *path, GError **error)
+{
+	g_autofree gchar *fn = NULL;
+	g_autofree gchar *pid = NULL;
+
+	g_return_val_if_fail (path != NULL, FALSE);
+
+	fn = g_build_filename (path, ACB_FILE_OWNER_NAME, NULL);
+	pid = g_strdup_printf ("%i\n", (gint) getpid ());
+	return g_file_set_contents (fn, pid, -1, error);
+}
+
+static gboolean
+acb_file_is_owned (const gchar *path)
+{
+	GStatBuf st;
+	guint64 pid;
+	g_autofree gchar *data = NULL;
+	g_autofree gchar *fn = NULL;
+
+	/* the owner is written just after the directory is created */
+	fn = g_build_filename (path, ACB_FILE_OWNER_NAME, NULL);
+	if (!g_file_get_contents (fn, &data, NULL, NULL)) {
+		if (g_lstat (path, &st) != 0)
+			return FALSE;
+		return (gint64) st.st_mtime > g_get_real_time () / G_USEC_PER_SEC -
+					      ACB_FILE_OWNER_GRACE;
+	}
+	pid = g_ascii_strtoull (data, NULL, 10);
+	if (pid == 0 || pid > G_MAXINT)
+		return FALSE;
+	return kill ((pid_t) pid, 0) == 0 || errno == EPERM;
+}
+
+/* removes what was left behind by runs that were killed */
+void
+acb_file_remove_unowned (const gchar *path)
+{
+	const gchar *filename;
+	g_autoptr(GDir) dir = NULL;
+
+	g_return_if_fail (path != NULL);
+
+	dir = g_dir_open (path, 0, NULL);
+	if (dir == NULL)
+		return;
+	while ((filename = g_dir_read_name (dir))) {
+		g_autofree gchar *child = g_build_filename (path, filename, NULL);
+		g_autoptr(GError) error = NULL;
+		if (!g_file_test (child, G_FILE_TEST_IS_DIR) ||
+		    g_file_test (child, G_FILE_TEST_IS_SYMLINK))
+			continue;
+		if (acb_file_is_owned (child))
+			continue;
+		g_debug ("removing abandoned %s", child);
+		if (!acb_file_remove_tree (child, &error))
+			g_warning ("failed to remove %s: %s", child, error->message);
+	}
+}
@@ -0,0 +1,47 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2018 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __ACB_FILE_H
+#define __ACB_FILE_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef enum {
+	ACB_FILE_COPY_FLAG_NONE			= 0,
+	ACB_FILE_COPY_FLAG_ALLOW_HARDLINK	= 1 << 0,	/* src is never modified */
+	ACB_FILE_COPY_FLAG_LAST
+} AcbFileCopyFlags;
+
+gboolean	 acb_file_copy				(const gchar		*src,
+							 const gchar		*dest,
+							 AcbFileCopyFlags	 flags,
+							 GError			**error);
+gboolean	 acb_file_remove_tree			(const gchar		*path,
+							 GError			**error);
+gboolean	 acb_file_set_owner			(const gchar		*path,
+							 GError			**error);
+void		 acb_file_remove_unowned		(const gchar		*path);
+
+G_END_DECLS
+
+#endif /* __ACB_FILE_H */
@@ -0,0 +1,223 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2018 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "acb-jobserver.h"
+
+/*
+ * This implements the server side of the GNU make jobserver protocol
+ * using a named pipe, see "POSIX Jobserver Interaction" in the GNU make
+ * manual. Each child make, ninja or rpmbuild is given MAKEFLAGS so that
+ * they all share the same pool of tokens. The one implicit token is used
+ * by the first job started by the scheduler.
+ *
+ * The fifo form needs GNU make 4.4 or ninja 1.13, and older versions of
+ * make stop with an error, so this is only used when JobserverSlots is set.
+ */
+
+typedef struct
+{
+	gchar			*tmpdir;
+	gchar			*fifo;
+	gchar			*makeflags;
+	gint			 fd;
+	guint			 slots;
+	gboolean		 implicit_free;
+	GMutex			 mutex;
+} AcbJobserverPrivate;
+
+G_DEFINE_TYPE_WITH_PRIVATE (AcbJobserver, acb_jobserver, G_TYPE_OBJECT)
+
+#define GET_PRIVATE(o) (acb_jobserver_get_instance_private (o))
+
+gboolean
+acb_jobserver_setup (AcbJobserver *jobserver, guint slots, GError **error)
+{
+	AcbJobserverPrivate *priv = GET_PRIVATE (jobserver);
+	guint i;
+
+	g_return_val_if_fail (ACB_IS_JOBSERVER (jobserver), FALSE);
+	g_return_val_if_fail (slots > 0, FALSE);
+	g_return_val_if_fail (priv->fd < 0, FALSE);
+
+	/* create somewhere private for the fifo */
+	priv->tmpdir = g_dir_make_tmp ("acb-jobserver-XXXXXX", error);
+	if (priv->tmpdir == NULL)
+		return FALSE;
+	priv->fifo = g_build_filename (priv->tmpdir, "fifo", NULL);
+	if (mkfifo (priv->fifo, 0600) != 0) {
+		g_set_error (error, 1, 0, "failed to create %s: %s",
+			     priv->fifo, g_strerror (errno));
+		return FALSE;
+	}
+
+	/* keep it open for reading and writing so children never see EOF */
+	priv->fd = g_open (priv->fifo, O_RDWR | O_CLOEXEC, 0);
+	if (priv->fd < 0) {
+		g_set_error (error, 1, 0, "failed to open %s: %s",
+			     priv->fifo, g_strerror (errno));
+		return FALSE;
+	}
+
+	/* the implicit token is not in the pipe */
+	for (i = 0; i < slots - 1; i++) {
+		if (write (priv->fd, "+", 1) != 1) {
+			g_set_error (error, 1, 0, "failed to write token: %s",
+				     g_strerror (errno));
+			return FALSE;
+		}
+	}
+	priv->slots = slots;
+	priv->implicit_free = TRUE;
+	priv->makeflags = g_strdup_printf ("-j --jobserver-auth=fifo:%s", priv->fifo);
+	return TRUE;
+}
+
+const gchar *
+acb_jobserver_get_makeflags (AcbJobserver *jobserver)
+{
+	AcbJobserverPrivate *priv = GET_PRIVATE (jobserver);
+	g_return_val_if_fail (ACB_IS_JOBSERVER (jobserver), NULL);
+	return priv->makeflags;
+}
+
+guint
+acb_jobserver_get_slots (AcbJobserver *jobserver)
+{
+	AcbJobserverPrivate *priv = GET_PRIVATE (jobserver);
+	g_return_val_if_fail (ACB_IS_JOBSERVER (jobserver), 0);
+	return priv->slots;
+}
+
+/* blocks until a token is available */
+gboolean
+acb_jobserver_acquire (AcbJobserver *jobserver, GError **error)
+{
+	AcbJobserverPrivate *priv = GET_PRIVATE (jobserver);
+	gchar token;
+	gssize len;
+
+	g_return_val_if_fail (ACB_IS_JOBSERVER (jobserver), FALSE);
+	g_return_val_if_fail (priv->fd >= 0, FALSE);
+
+	/* use the implicit token if nothing else is */
+	g_mutex_lock (&priv->mutex);
+	if (priv->implicit_free) {
+		priv->implicit_free = FALSE;
+		g_mutex_unlock (&priv->mutex);
+		return TRUE;
+	}
+	g_mutex_unlock (&priv->mutex);
+
+	/* wait for a child to give one back */
+	do {
+		len = read (priv->fd, &token, 1);
+	} while (len < 0 && errno == EINTR);
+	if (len != 1) {
+		g_set_error (error, 1, 0, "failed to read token: %s",
+			     len < 0 ? g_strerror (errno) : "EOF");
+		return FALSE;
+	}
+	return TRUE;
+}
+
+void
+acb_jobserver_release (AcbJobserver *jobserver)
+{
+	AcbJobserverPrivate *priv = GET_PRIVATE (jobserver);
+	gssize len;
+
+	g_return_if_fail (ACB_IS_JOBSERVER (jobserver));
+	g_return_if_fail (priv->fd >= 0);
+
+	/* tokens are all the same, so hand back the implicit one first */
+	g_mutex_lock (&priv->mutex);
+	if (!priv->implicit_free) {
+		priv->implicit_free = TRUE;
+		g_mutex_unlock (&priv->mutex);
+		return;
+	}
+	g_mutex_unlock (&priv->mutex);
+	do {
+		len = write (priv->fd, "+", 1);
+	} while (len < 0 && errno == EINTR);
+	if (len != 1)
+		g_warning ("failed to write token: %s", g_strerror (errno));
+}
+
+static void
+acb_jobserver_finalize (GObject *object)
+{
+	AcbJobserver *jobserver;
+	AcbJobserverPrivate *priv;
+
+	g_return_if_fail (object != NULL);
+	g_return_if_fail (ACB_IS_JOBSERVER (object));
+	jobserver = ACB_JOBSERVER (object);
+	priv = GET_PRIVATE (jobserver);
+
+	if (priv->fd >= 0)
+		close (priv->fd);
+	if (priv->fifo != NULL)
+		g_unlink (priv->fifo);
+	if (priv->tmpdir != NULL)
+		g_rmdir (priv->tmpdir);
+	g_free (priv->tmpdir);
+	g_free (priv->fifo);
+	g_free (priv->makeflags);
+	g_mutex_clear (&priv->mutex);
+
+	G_OBJECT_CLASS (acb_jobserver_parent_class)->finalize (object);
+}
+
+static void
+acb_jobserver_class_init (AcbJobserverClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->finalize = acb_jobserver_finalize;
+}
+
+static void
+acb_jobserver_init (AcbJobserver *jobserver)
+{
+	AcbJobserverPrivate *priv = GET_PRIVATE (jobserver);
+	priv->fd = -1;
+	g_mutex_init (&priv->mutex);
+}
+
+AcbJobserver *
+acb_jobserver_new (void)
+{
+	AcbJobserver *jobserver;
+	jobserver = g_object_new (ACB_TYPE_JOBSERVER, NULL);
+	return ACB_JOBSERVER (jobserver);
+}
@@ -0,0 +1,49 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2018 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __ACB_JOBSERVER_H
+#define __ACB_JOBSERVER_H
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+#define ACB_TYPE_JOBSERVER (acb_jobserver_get_type ())
+G_DECLARE_DERIVABLE_TYPE (AcbJobserver, acb_jobserver, ACB, JOBSERVER, GObject)
+
+struct _AcbJobserverClass
+{
+	GObjectClass		parent_class;
+};
+
+AcbJobserver	*acb_jobserver_new			(void);
+gboolean	 acb_jobserver_setup			(AcbJobserver		*jobserver,
+							 guint			 slots,
+							 GError			**error);
+const gchar	*acb_jobserver_get_makeflags		(AcbJobserver		*jobserver);
+guint		 acb_jobserver_get_slots		(AcbJobserver		*jobserver);
+gboolean	 acb_jobserver_acquire			(AcbJobserver		*jobserver,
+							 GError			**error);
+void		 acb_jobserver_release			(AcbJobserver		*jobserver);
+
+G_END_DECLS
+
+#endif /* __ACB_JOBSERVER_H */
@@ -0,0 +1,191 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2018 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <glib.h>
+
+#include "acb-load.h"
+
+typedef struct
+{
+	gdouble			 max_load;		/* 1 minute average */
+	guint64			 min_memory;		/* MiB */
+	gdouble			 max_cpu_pressure;	/* percent, 10 second average */
+	gdouble			 max_memory_pressure;	/* percent, 10 second average */
+} AcbLoadPrivate;
+
+G_DEFINE_TYPE_WITH_PRIVATE (AcbLoad, acb_load, G_TYPE_OBJECT)
+
+#define GET_PRIVATE(o) (acb_load_get_instance_private (o))
+
+static gboolean
+acb_load_get_loadavg (gdouble *value)
+{
+	g_autofree gchar *data = NULL;
+
+	if (!g_file_get_contents ("/proc/loadavg", &data, NULL, NULL))
+		return FALSE;
+	*value = g_ascii_strtod (data, NULL);
+	return TRUE;
+}
+
+static gboolean
+acb_load_get_memory_available (guint64 *value)
+{
+	guint i;
+	g_autofree gchar *data = NULL;
+	g_auto(GStrv) lines = NULL;
+
+	if (!g_file_get_contents ("/proc/meminfo", &data, NULL, NULL))
+		return FALSE;
+
+	/* MemAvailable:   12345678 kB */
+	lines = g_strsplit (data, "\n", -1);
+	for (i = 0; lines[i] != NULL; i++) {
+		if (!g_str_has_prefix (lines[i], "MemAvailable:"))
+			continue;
+		*value = g_ascii_strtoull (lines[i] + 13, NULL, 10) / 1024;
+		return TRUE;
+	}
+	return FALSE;
+}
+
+static gboolean
+acb_load_get_pressure (const gchar *filename, gdouble *value)
+{
+	const gchar *tmp;
+	g_autofree gchar *data = NULL;
+
+	/* needs CONFIG_PSI, so not fatal */
+	if (!g_file_get_contents (filename, &data, NULL, NULL))
+		return FALSE;
+
+	/* some avg10=1.23 avg60=0.50 avg300=0.10 total=12345 */
+	if (!g_str_has_prefix (data, "some "))
+		return FALSE;
+	tmp = g_strstr_len (data, -1, "avg10=");
+	if (tmp == NULL)
+		return FALSE;
+	*value = g_ascii_strtod (tmp + 6, NULL);
+	return TRUE;
+}
+
+void
+acb_load_set_from_defaults (AcbLoad *load, GKeyFile *file)
+{
+	AcbLoadPrivate *priv = GET_PRIVATE (load);
+
+	g_return_if_fail (ACB_IS_LOAD (load));
+
+	/* any value of zero disables the check */
+	if (g_key_file_has_key (file, "defaults", "MaxLoad", NULL))
+		priv->max_load = g_key_file_get_double (file, "defaults", "MaxLoad", NULL);
+	if (g_key_file_has_key (file, "defaults", "MinMemoryAvailable", NULL))
+		priv->min_memory = g_key_file_get_uint64 (file, "defaults", "MinMemoryAvailable", NULL);
+	if (g_key_file_has_key (file, "defaults", "MaxCpuPressure", NULL))
+		priv->max_cpu_pressure = g_key_file_get_double (file, "defaults", "MaxCpuPressure", NULL);
+	if (g_key_file_has_key (file, "defaults", "MaxMemoryPressure", NULL))
+		priv->max_memory_pressure = g_key_file_get_double (file, "defaults", "MaxMemoryPressure", NULL);
+}
+
+gboolean
+acb_load_has_limits (AcbLoad *load)
+{
+	AcbLoadPrivate *priv = GET_PRIVATE (load);
+
+	g_return_val_if_fail (ACB_IS_LOAD (load), FALSE);
+
+	return priv->max_load > 0 ||
+	       priv->min_memory > 0 ||
+	       priv->max_cpu_pressure > 0 ||
+	       priv->max_memory_pressure > 0;
+}
+
+gboolean
+acb_load_is_busy (AcbLoad *load, gchar **reason)
+{
+	AcbLoadPrivate *priv = GET_PRIVATE (load);
+	gdouble value;
+	guint64 memory;
+
+	g_return_val_if_fail (ACB_IS_LOAD (load), FALSE);
+
+	if (priv->max_load > 0 &&
+	    acb_load_get_loadavg (&value) &&
+	    value > priv->max_load) {
+		if (reason != NULL)
+			*reason = g_strdup_printf ("load average %.1f above %.1f",
+						   value, priv->max_load);
+		return TRUE;
+	}
+	if (priv->min_memory > 0 &&
+	    acb_load_get_memory_available (&memory) &&
+	    memory < priv->min_memory) {
+		if (reason != NULL)
+			*reason = g_strdup_printf ("only %" G_GUINT64_FORMAT "MiB of memory available",
+						   memory);
+		return TRUE;
+	}
+	if (priv->max_cpu_pressure > 0 &&
+	    acb_load_get_pressure ("/proc/pressure/cpu", &value) &&
+	    value > priv->max_cpu_pressure) {
+		if (reason != NULL)
+			*reason = g_strdup_printf ("CPU pressure %.1f%% above %.1f%%",
+						   value, priv->max_cpu_pressure);
+		return TRUE;
+	}
+	if (priv->max_memory_pressure > 0 &&
+	    acb_load_get_pressure ("/proc/pressure/memory", &value) &&
+	    value > priv->max_memory_pressure) {
+		if (reason != NULL)
+			*reason = g_strdup_printf ("memory pressure %.1f%% above %.1f%%",
+						   value, priv->max_memory_pressure);
+		return TRUE;
+	}
+	return FALSE;
+}
+
+static void
+acb_load_class_init (AcbLoadClass *klass)
+{
+}
+
+static void
+acb_load_init (AcbLoad *load)
+{
+	AcbLoadPrivate *priv = GET_PRIVATE (load);
+
+	/* sensible defaults that only stop the machine from swapping */
+	priv->max_load = (gdouble) g_get_num_processors ();
+	priv->min_memory = 1024;
+	priv->max_memory_pressure = 10.0;
+}
+
+AcbLoad *
+acb_load_new (void)
+{
+	AcbLoad *load;
+	load = g_object_new (ACB_TYPE_LOAD, NULL);
+	return ACB_LOAD (load);
+}
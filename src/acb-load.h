@@ -0,0 +1,46 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2018 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __ACB_LOAD_H
+#define __ACB_LOAD_H
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+#define ACB_TYPE_LOAD (acb_load_get_type ())
+G_DECLARE_DERIVABLE_TYPE (AcbLoad, acb_load, ACB, LOAD, GObject)
+
+struct _AcbLoadClass
+{
+	GObjectClass		parent_class;
+};
+
+AcbLoad		*acb_load_new				(void);
+void		 acb_load_set_from_defaults		(AcbLoad		*load,
+							 GKeyFile		*file);
+gboolean	 acb_load_has_limits			(AcbLoad		*load);
+gboolean	 acb_load_is_busy			(AcbLoad		*load,
+							 gchar			**reason);
+
+G_END_DECLS
+
+#endif /* __ACB_LOAD_H */
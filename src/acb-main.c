@@ -19,54 +19,149 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
+#include <signal.h>
+#include <string.h>
 #include <glib-object.h>
 
+#include "acb-ccache.h"
+#include "acb-daemon.h"
+#include "acb-file.h"
+#include "acb-jobserver.h"
+#include "acb-load.h"
+#include "acb-manifest.h"
+#include "acb-prefetch.h"
+#include "acb-probe.h"
 #include "acb-project.h"
+#include "acb-repo.h"
+#include "acb-scheduler.h"
+#include "acb-spawn.h"
+#include "acb-target.h"
 #include "acb-common.h"
 
-static gboolean
-acb_main_process_project_name (const gchar *default_code_path,
-			       const gchar *project_name,
-			       gboolean clean,
-			       gboolean update,
-			       gboolean build,
-			       gboolean make,
-			       const gchar *rpmbuild_path)
+/* pressing Ctrl-C twice within this many seconds stops everything */
+#define ACB_MAIN_INTERRUPT_TIMEOUT	2
+
+static void
+acb_main_signal_cb (gint signum)
 {
-	g_autofree gchar *path = NULL;
-	g_autoptr(AcbProject) project = NULL;
-	g_autoptr(GError) error = NULL;
+	static gint64 last_interrupt = 0;
+	gint64 now = g_get_monotonic_time ();
+
+	/* Ctrl-C just kills the current commands so the batch can continue */
+	if (signum == SIGINT &&
+	    now - last_interrupt > ACB_MAIN_INTERRUPT_TIMEOUT * G_USEC_PER_SEC) {
+		last_interrupt = now;
+		acb_spawn_cancel_all (FALSE);
+		return;
+	}
+	acb_spawn_cancel_all (TRUE);
+}
+
+static void
+acb_main_setup_signals (void)
+{
+	struct sigaction sa;
+
+	memset (&sa, 0, sizeof (sa));
+	sa.sa_handler = acb_main_signal_cb;
+	sigemptyset (&sa.sa_mask);
+	sigaction (SIGINT, &sa, NULL);
+	sigaction (SIGTERM, &sa, NULL);
+}
+
+static void
+acb_main_add_project_name (GPtrArray *projects,
+			   GKeyFile *defaults,
+			   AcbManifest *manifest,
+			   AcbProbe *probe,
+			   AcbJobserver *jobserver,
+			   AcbCcache *ccache,
+			   GPtrArray *targets,
+			   const gchar *default_code_path,
+			   const gchar *project_name,
+			   const gchar *rpmbuild_path)
+{
+	AcbProject *project;
 
 	/* operate on folder */
 	project = acb_project_new ();
 	acb_project_set_default_code_path (project, default_code_path);
 	acb_project_set_rpmbuild_path (project, rpmbuild_path);
+	acb_project_set_jobserver (project, jobserver);
+	acb_project_set_ccache (project, ccache);
+	acb_project_set_targets (project, targets);
+	acb_project_set_manifest (project, manifest);
+	acb_project_set_probe (project, probe);
+	acb_project_set_defaults (project, defaults);
 	acb_project_set_name (project, project_name);
-	if (clean) {
-		if (!acb_project_clean (project, &error)) {
-			g_print ("Failed to clean: %s\n", error->message);
-			return FALSE;
-		}
-	}
-	if (update) {
-		if (!acb_project_update (project, &error)) {
-			g_print ("Failed to update: %s\n", error->message);
-			return FALSE;
-		}
+	g_ptr_array_add (projects, project);
+}
+
+static guint
+acb_main_ptr_array_find_str (GPtrArray *array, const gchar *str)
+{
+	guint i;
+	for (i = 0; i < array->len; i++) {
+		if (g_strcmp0 (g_ptr_array_index (array, i), str) == 0)
+			break;
 	}
-	if (make) {
-		if (!acb_project_make (project, &error)) {
-			g_print ("Failed to make: %s\n", error->message);
-			return FALSE;
-		}
+	return i;
+}
+
+/* several targets can share the SRPMS directory */
+static GPtrArray *
+acb_main_get_repos (GPtrArray *targets, const gchar *rpmbuild_path)
+{
+	GPtrArray *repos = g_ptr_array_new_with_free_func (g_free);
+	guint i;
+
+	for (i = 0; i < targets->len; i++) {
+		AcbTarget *target = g_ptr_array_index (targets, i);
+		g_autofree gchar *repo = acb_target_get_repo_dir (target, rpmbuild_path);
+		g_autofree gchar *repo_srpms = acb_target_get_srpm_repo_dir (target, rpmbuild_path);
+		if (acb_main_ptr_array_find_str (repos, repo) == repos->len)
+			g_ptr_array_add (repos, g_steal_pointer (&repo));
+		if (acb_main_ptr_array_find_str (repos, repo_srpms) == repos->len)
+			g_ptr_array_add (repos, g_steal_pointer (&repo_srpms));
 	}
-	if (build) {
-		if (!acb_project_build (project, &error)) {
-			g_print ("Failed to build: %s\n", error->message);
-			return FALSE;
-		}
+	return repos;
+}
+
+/* update anything already installed from the local repo */
+static gboolean
+acb_main_install (const gchar *repo, GError **error)
+{
+	const gchar *filename;
+	gint exit_status = 0;
+	g_autoptr(GDir) dir = NULL;
+	g_autoptr(GPtrArray) argv = NULL;
+
+	dir = g_dir_open (repo, 0, error);
+	if (dir == NULL)
+		return FALSE;
+	argv = g_ptr_array_new_with_free_func (g_free);
+	g_ptr_array_add (argv, g_strdup ("pkexec"));
+	g_ptr_array_add (argv, g_strdup ("rpm"));
+	g_ptr_array_add (argv, g_strdup ("-Fvh"));
+	while ((filename = g_dir_read_name (dir))) {
+		if (!g_str_has_suffix (filename, ".rpm"))
+			continue;
+		g_ptr_array_add (argv, g_build_filename (repo, filename, NULL));
 	}
-	return TRUE;
+	if (argv->len == 3)
+		return TRUE;
+	g_ptr_array_add (argv, NULL);
+	if (!g_spawn_sync (NULL, (gchar **) argv->pdata, NULL,
+			   G_SPAWN_SEARCH_PATH | G_SPAWN_CHILD_INHERITS_STDIN,
+			   NULL, NULL, NULL, NULL, &exit_status, error))
+		return FALSE;
+	return g_spawn_check_exit_status (exit_status, error);
+}
+
+static gint
+acb_main_sort_names_cb (gconstpointer a, gconstpointer b)
+{
+	return g_strcmp0 (*((const gchar **) a), *((const gchar **) b));
 }
 
 static gboolean
@@ -81,16 +176,17 @@ acb_main_ensure_has_path (const gchar *path)
 	return (retval == 0);
 }
 
-static gchar *
-acb_main_get_code_dir ()
+static GKeyFile *
+acb_main_load_defaults (void)
 {
-	gchar *code_dir = NULL;
+	GKeyFile *file;
+	g_autofree gchar *code_dir = NULL;
 	g_autofree gchar *config_file = NULL;
 	g_autofree gchar *data = NULL;
 	g_autoptr(GError) error = NULL;
-	g_autoptr(GKeyFile) file = NULL;
 
 	/* find the file, else create it */
+	file = g_key_file_new ();
 	config_file = g_build_filename (g_get_user_config_dir (),
 					"autocodebuild",
 					"defaults.conf",
@@ -104,16 +200,25 @@ acb_main_get_code_dir ()
 
 		/* save to the file */
 		g_file_set_contents (config_file, data, -1, NULL);
-		return code_dir;
+		g_key_file_load_from_data (file, data, -1, G_KEY_FILE_NONE, NULL);
+		return file;
 	}
 
 	/* load from file */
-	file = g_key_file_new ();
-	g_key_file_load_from_file (file, config_file, G_KEY_FILE_NONE, &error);
-	code_dir = g_key_file_get_string (file, "defaults", "CodeDirectory", NULL);
+	if (!g_key_file_load_from_file (file, config_file, G_KEY_FILE_NONE, &error))
+		g_warning ("cannot load %s: %s", config_file, error->message);
+	return file;
+}
+
+static gchar *
+acb_main_get_code_dir (GKeyFile *file)
+{
+	gchar *code_dir = NULL;
+	g_autoptr(GError) error = NULL;
+
+	code_dir = g_key_file_get_string (file, "defaults", "CodeDirectory", &error);
 	if (code_dir == NULL) {
 		g_error ("cannot load: %s", error->message);
-		g_error_free (error);
 		return NULL;
 	}
 	return code_dir;
@@ -149,22 +254,41 @@ int
 main (int argc, char **argv)
 {
 	GOptionContext *context;
-	gboolean ret;
 	gboolean verbose = FALSE;
 	gboolean install = FALSE;
 	gboolean clean = FALSE;
 	gboolean update = FALSE;
 	gboolean build = FALSE;
 	gboolean make = FALSE;
+	gboolean only_changed = FALSE;
+	gboolean watch = FALSE;
+	gboolean prefetch = FALSE;
+	gboolean ret;
+	gint jobs = 1;
+	gint io_jobs = 0;
+	gint fetch_jobs = 0;
+	gint jobserver_slots = 0;
 	guint i;
-	const gchar *filename;
-	gchar *tmp;
+	AcbSchedulerFlags flags = ACB_SCHEDULER_FLAG_NONE;
 	g_autofree gchar *code_path = NULL;
 	g_autofree gchar *options_help = NULL;
 	g_autofree gchar *rpmbuild_path = NULL;
-	g_autofree gchar *user_data = NULL;
 	g_auto(GStrv) files = NULL;
+	g_autoptr(AcbCcache) ccache = NULL;
+	g_autoptr(AcbDaemon) daemon = NULL;
+	g_autoptr(AcbJobserver) jobserver = NULL;
+	g_autoptr(AcbLoad) load = NULL;
+	g_autoptr(AcbManifest) manifest = NULL;
+	g_autoptr(AcbPrefetch) prefetcher = NULL;
+	g_autoptr(AcbProbe) probe = NULL;
+	g_autoptr(AcbScheduler) scheduler = NULL;
 	g_autoptr(GError) error = NULL;
+	g_autoptr(GError) error_local = NULL;
+	g_autoptr(GKeyFile) defaults = NULL;
+	g_autoptr(GPtrArray) projects = NULL;
+	g_autoptr(GPtrArray) repos = NULL;
+	g_autoptr(GPtrArray) stats = NULL;
+	g_autoptr(GPtrArray) targets = NULL;
 
 	const GOptionEntry options[] = {
 		{ "verbose", 'v', 0, G_OPTION_ARG_NONE, &verbose,
@@ -177,8 +301,20 @@ main (int argc, char **argv)
 			"Build projects", NULL},
 		{ "make", 'm', 0, G_OPTION_ARG_NONE, &make,
 			"Make projects", NULL},
+		{ "only-changed", '\0', 0, G_OPTION_ARG_NONE, &only_changed,
+			"Only make and build projects with new upstream commits", NULL},
 		{ "install", 'i', 0, G_OPTION_ARG_NONE, &install,
 			"Install projects", NULL},
+		{ "daemon", '\0', 0, G_OPTION_ARG_NONE, &watch,
+			"Keep running, and make or build projects when they change", NULL},
+		{ "prefetch", '\0', 0, G_OPTION_ARG_NONE, &prefetch,
+			"Fetch the projects that are due so that updating does not need the network", NULL},
+		{ "jobs", 'j', 0, G_OPTION_ARG_INT, &jobs,
+			"Number of projects to process at once, or 0 for one per CPU", "N"},
+		{ "io-jobs", '\0', 0, G_OPTION_ARG_INT, &io_jobs,
+			"Number of projects to update while others are building", "N"},
+		{ "fetch-jobs", '\0', 0, G_OPTION_ARG_INT, &fetch_jobs,
+			"Number of projects to fetch at once in the background", "N"},
 		{ G_OPTION_REMAINING, '\0', 0, G_OPTION_ARG_FILENAME_ARRAY, &files,
 			"Projects", NULL },
 		{ NULL}
@@ -194,71 +330,219 @@ main (int argc, char **argv)
 		g_setenv ("G_MESSAGES_DEBUG", "all", TRUE);
 
 	/* get the code location */
-	code_path = acb_main_get_code_dir ();
+	defaults = acb_main_load_defaults ();
+	code_path = acb_main_get_code_dir (defaults);
 
 	/* get the code location */
 	rpmbuild_path = acb_main_get_rpmbuild_dir ();
 
 	/* didn't specify any options */
-	if (files == NULL && !clean && !update && !build && !make && !install) {
+	if (files == NULL && !clean && !update && !build && !make && !install &&
+	    !only_changed && !watch && !prefetch) {
 		g_print ("%s\n", options_help);
 		return 0;
 	}
 
+	/* what to do to each project */
+	if (clean)
+		flags |= ACB_SCHEDULER_FLAG_CLEAN;
+	if (update)
+		flags |= ACB_SCHEDULER_FLAG_UPDATE;
+	if (make)
+		flags |= ACB_SCHEDULER_FLAG_MAKE;
+	if (build)
+		flags |= ACB_SCHEDULER_FLAG_BUILD;
+	if (only_changed)
+		flags |= ACB_SCHEDULER_FLAG_UPDATE | ACB_SCHEDULER_FLAG_ONLY_CHANGED;
+	scheduler = acb_scheduler_new ();
+	acb_scheduler_set_flags (scheduler, flags);
+	acb_scheduler_set_jobs (scheduler, (guint) MAX (jobs, 0));
+	acb_scheduler_set_io_jobs (scheduler, (guint) MAX (io_jobs, 0));
+
+	/* only start new builds when the machine can cope */
+	load = acb_load_new ();
+	acb_load_set_from_defaults (load, defaults);
+	acb_scheduler_set_load (scheduler, load);
+
+	/* share one pool of make job slots between all the builds, but only
+	 * when asked as older make versions fail on the fifo auth form */
+	if (g_key_file_has_key (defaults, "defaults", "JobserverSlots", NULL))
+		jobserver_slots = g_key_file_get_integer (defaults, "defaults", "JobserverSlots", NULL);
+	if (jobserver_slots > 0) {
+		jobserver = acb_jobserver_new ();
+		if (!acb_jobserver_setup (jobserver, (guint) jobserver_slots, &error)) {
+			g_warning ("cannot set up jobserver: %s", error->message);
+			return 1;
+		}
+		acb_scheduler_set_jobserver (scheduler, jobserver);
+	}
+
+	/* a build that was killed leaves its private rpmbuild tree behind */
+	if ((flags & ACB_SCHEDULER_FLAG_BUILD) > 0 && rpmbuild_path != NULL) {
+		g_autofree gchar *tmpdir = g_build_filename (rpmbuild_path, "tmp", NULL);
+		acb_file_remove_unowned (tmpdir);
+	}
+
+	/* what to build the packages for */
+	targets = acb_target_load_all (defaults);
+
+	/* route the compilers through one shared cache */
+	if (g_key_file_get_boolean (defaults, "defaults", "Ccache", NULL)) {
+		ccache = acb_ccache_new ();
+		if (!acb_ccache_set_from_defaults (ccache, defaults, &error)) {
+			g_warning ("cannot set up ccache: %s", error->message);
+			return 1;
+		}
+	}
+
+	/* read every project config in one go */
+	manifest = acb_manifest_new ();
+	if (!acb_manifest_load (manifest, &error)) {
+		g_warning ("cannot load projects: %s", error->message);
+		return 1;
+	}
+	probe = acb_probe_new ();
+	if (!acb_probe_load (probe, &error)) {
+		g_warning ("cannot load probe cache: %s", error->message);
+		return 1;
+	}
+
 	/* process the list */
+	projects = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
 	if (files != NULL) {
 		for (i = 0; files[i] != NULL; i++) {
-			acb_main_process_project_name (code_path,
-						       files[i],
-						       clean,
-						       update,
-						       build,
-						       make,
-						       rpmbuild_path);
+			acb_main_add_project_name (projects,
+						   defaults,
+						   manifest,
+						   probe,
+						   jobserver,
+						   ccache,
+						   targets,
+						   code_path,
+						   files[i],
+						   rpmbuild_path);
 		}
 	} else {
-		g_autoptr(GDir) dir = NULL;
-
-		/* try to open */
-		user_data = g_build_filename (g_get_user_data_dir (),
-					      "autocodebuild",
-					      NULL);
-		dir = g_dir_open (user_data, 0, &error);
-		if (dir == NULL) {
-			g_warning ("cannot open directory: %s",
-				     error->message);
-			g_error_free (error);
-			return 1;
+		g_autoptr(GPtrArray) project_names = NULL;
+
+		/* use a stable order, the scheduler handles the dependencies */
+		project_names = acb_manifest_get_names (manifest);
+		g_ptr_array_sort (project_names, acb_main_sort_names_cb);
+		for (i = 0; i < project_names->len; i++) {
+			acb_main_add_project_name (projects,
+						   defaults,
+						   manifest,
+						   probe,
+						   jobserver,
+						   ccache,
+						   targets,
+						   code_path,
+						   g_ptr_array_index (project_names, i),
+						   rpmbuild_path);
 		}
+	}
 
-		/* find each */
-		while ((filename = g_dir_read_name (dir))) {
-			g_autofree gchar *project_name = NULL;
-			if (!g_str_has_suffix (filename, ".conf"))
-				continue;
-			project_name = g_strdup (filename);
-			tmp = g_strrstr (project_name, ".");
-			*tmp = '\0';
-			acb_main_process_project_name (code_path,
-						       project_name,
-						       clean,
-						       update,
-						       build,
-						       make,
-						       rpmbuild_path);
+	/* fetch ahead of time, either now or from the daemon */
+	if (prefetch || (watch && (flags & ACB_SCHEDULER_FLAG_UPDATE) > 0)) {
+		prefetcher = acb_prefetch_new ();
+		if (fetch_jobs > 0)
+			acb_prefetch_set_jobs (prefetcher, (guint) fetch_jobs);
+		for (i = 0; i < projects->len; i++)
+			acb_prefetch_add_project (prefetcher, g_ptr_array_index (projects, i));
+	}
+
+	/* run everything */
+	for (i = 0; i < projects->len; i++)
+		acb_scheduler_add_project (scheduler, g_ptr_array_index (projects, i));
+	acb_main_setup_signals ();
+	if (prefetch && !acb_prefetch_run (prefetcher, &error)) {
+		g_warning ("cannot fetch projects: %s", error->message);
+		return 1;
+	}
+	ret = acb_scheduler_run (scheduler, &error);
+
+	/* even if the run failed, some projects will have a new release */
+	if (!acb_manifest_save (manifest, &error_local)) {
+		g_warning ("cannot save projects: %s", error_local->message);
+		g_clear_error (&error_local);
+	}
+	if (!acb_probe_save (probe, &error_local))
+		g_warning ("cannot save probe cache: %s", error_local->message);
+	if (!ret) {
+		g_warning ("cannot process projects: %s", error->message);
+		return 1;
+	}
+	if (flags != ACB_SCHEDULER_FLAG_NONE)
+		acb_scheduler_print_summary (scheduler);
+
+	/* show where the time went */
+	stats = acb_scheduler_get_stats (scheduler);
+	if (stats->len > 0) {
+		g_autofree gchar *stats_fn = NULL;
+		acb_stats_print_report (stats, 10);
+		stats_fn = g_build_filename (g_get_user_data_dir (),
+					     "autocodebuild",
+					     "stats.tsv",
+					     NULL);
+		if (!acb_stats_save (stats, stats_fn, &error)) {
+			g_warning ("cannot save stats: %s", error->message);
+			g_clear_error (&error);
+		}
+	}
+
+	/* refresh the metadata once for everything that was built */
+	repos = acb_main_get_repos (targets, rpmbuild_path);
+	if (build) {
+		g_print ("%s...", "Publishing repository");
+		for (i = 0; i < repos->len; i++) {
+			const gchar *repo = g_ptr_array_index (repos, i);
+			if (!acb_repo_publish (repo, &error)) {
+				g_print ("\n");
+				g_warning ("cannot publish: %s", error->message);
+				return 1;
+			}
 		}
+		g_print ("\t%s\n", "Done");
 	}
 
-	/* all install */
+	/* all install, using the first target */
 	if (install) {
-		ret = g_spawn_command_line_sync ("pkexec rpm -Fvh /home/hughsie/rpmbuild/REPOS/fedora/28/x86_64/*.rpm",
-						 NULL, NULL, NULL, &error);
-		if (!ret) {
+		g_autofree gchar *repo = NULL;
+		repo = acb_target_get_repo_dir (g_ptr_array_index (targets, 0), rpmbuild_path);
+		if (!acb_main_install (repo, &error)) {
 			g_warning ("cannot install packages: %s", error->message);
-			g_error_free (error);
 			return 1;
 		}
 	}
+
+	/* rebuild each project when it changes, using the same settings */
+	if (watch) {
+		AcbSchedulerFlags flags_daemon;
+		flags_daemon = flags & (ACB_SCHEDULER_FLAG_UPDATE |
+					ACB_SCHEDULER_FLAG_MAKE |
+					ACB_SCHEDULER_FLAG_BUILD);
+		if ((flags_daemon & (ACB_SCHEDULER_FLAG_MAKE | ACB_SCHEDULER_FLAG_BUILD)) == 0)
+			flags_daemon |= ACB_SCHEDULER_FLAG_MAKE;
+		daemon = acb_daemon_new ();
+		acb_daemon_set_flags (daemon, flags_daemon);
+		acb_daemon_set_jobs (daemon, (guint) MAX (jobs, 0));
+		acb_daemon_set_load (daemon, load);
+		acb_daemon_set_jobserver (daemon, jobserver);
+		acb_daemon_set_manifest (daemon, manifest);
+		acb_daemon_set_probe (daemon, probe);
+		acb_daemon_set_repos (daemon, repos);
+		if (flags_daemon & ACB_SCHEDULER_FLAG_UPDATE)
+			acb_daemon_set_prefetch (daemon, prefetcher);
+		for (i = 0; i < projects->len; i++)
+			acb_daemon_add_project (daemon, g_ptr_array_index (projects, i));
+		if (!acb_daemon_run (daemon, &error)) {
+			g_warning ("cannot watch projects: %s", error->message);
+			return 1;
+		}
+		return 0;
+	}
+	if (acb_scheduler_get_failed (scheduler) > 0)
+		return 1;
 	return 0;
 }
 
@@ -0,0 +1,413 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2018 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <errno.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "acb-manifest.h"
+
+typedef struct
+{
+	gchar			*directory;
+	gchar			*index_fn;
+	GHashTable		*entries;	/* name : AcbManifestEntry */
+	GMutex			 mutex;		/* projects save from worker threads */
+} AcbManifestPrivate;
+
+typedef struct {
+	GKeyFile		*file;
+	GHashTable		*changed;	/* key : value, for the defaults group */
+	gint64			 mtime;		/* usec, or 0 if not on disk */
+	gint64			 size;
+} AcbManifestEntry;
+
+G_DEFINE_TYPE_WITH_PRIVATE (AcbManifest, acb_manifest, G_TYPE_OBJECT)
+
+#define GET_PRIVATE(o) (acb_manifest_get_instance_private (o))
+
+static void
+acb_manifest_entry_free (AcbManifestEntry *entry)
+{
+	g_key_file_unref (entry->file);
+	g_hash_table_unref (entry->changed);
+	g_free (entry);
+}
+
+static AcbManifestEntry *
+acb_manifest_entry_new (void)
+{
+	AcbManifestEntry *entry = g_new0 (AcbManifestEntry, 1);
+	entry->file = g_key_file_new ();
+	entry->changed = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+	return entry;
+}
+
+static gchar *
+acb_manifest_get_filename (AcbManifest *manifest, const gchar *name)
+{
+	AcbManifestPrivate *priv = GET_PRIVATE (manifest);
+	g_autofree gchar *basename = g_strdup_printf ("%s.conf", name);
+	return g_build_filename (priv->directory, basename, NULL);
+}
+
+/* in-place edits do not change the directory mtime, so check each file */
+static gboolean
+acb_manifest_stat (const gchar *filename, gint64 *mtime, gint64 *size)
+{
+	GStatBuf st;
+	if (g_stat (filename, &st) != 0)
+		return FALSE;
+	*mtime = (gint64) st.st_mtim.tv_sec * G_USEC_PER_SEC + st.st_mtim.tv_nsec / 1000;
+	*size = (gint64) st.st_size;
+	return TRUE;
+}
+
+static gboolean
+acb_manifest_save_index (AcbManifest *manifest, GError **error)
+{
+	AcbManifestPrivate *priv = GET_PRIVATE (manifest);
+	GHashTableIter iter;
+	gpointer key;
+	gpointer value;
+	g_autofree gchar *data = NULL;
+	g_autofree gchar *dirname = NULL;
+	g_autoptr(GKeyFile) index = g_key_file_new ();
+
+	g_hash_table_iter_init (&iter, priv->entries);
+	while (g_hash_table_iter_next (&iter, &key, &value)) {
+		AcbManifestEntry *entry = (AcbManifestEntry *) value;
+		g_autofree gchar *file_data = NULL;
+		if (entry->mtime == 0)
+			continue;
+		file_data = g_key_file_to_data (entry->file, NULL, NULL);
+		g_key_file_set_int64 (index, key, "Mtime", entry->mtime);
+		g_key_file_set_int64 (index, key, "Size", entry->size);
+		g_key_file_set_string (index, key, "Data", file_data);
+	}
+	dirname = g_path_get_dirname (priv->index_fn);
+	if (g_mkdir_with_parents (dirname, 0755) != 0) {
+		g_set_error (error, 1, 0, "failed to create %s: %s",
+			     dirname, g_strerror (errno));
+		return FALSE;
+	}
+	data = g_key_file_to_data (index, NULL, error);
+	if (data == NULL)
+		return FALSE;
+	return g_file_set_contents (priv->index_fn, data, -1, error);
+}
+
+/* every project config is read once, using the index where it is still valid */
+gboolean
+acb_manifest_load (AcbManifest *manifest, GError **error)
+{
+	AcbManifestPrivate *priv = GET_PRIVATE (manifest);
+	const gchar *filename;
+	gboolean index_valid = TRUE;
+	gsize n_groups = 0;
+	guint n_cached = 0;
+	g_autoptr(GDir) dir = NULL;
+	g_autoptr(GKeyFile) index = g_key_file_new ();
+
+	g_return_val_if_fail (ACB_IS_MANIFEST (manifest), FALSE);
+
+	/* a missing or corrupt index just means everything is parsed */
+	if (!g_key_file_load_from_file (index, priv->index_fn, G_KEY_FILE_NONE, NULL))
+		index_valid = FALSE;
+	g_strfreev (g_key_file_get_groups (index, &n_groups));
+
+	dir = g_dir_open (priv->directory, 0, error);
+	if (dir == NULL)
+		return FALSE;
+	while ((filename = g_dir_read_name (dir))) {
+		AcbManifestEntry *entry;
+		gint64 mtime = 0;
+		gint64 size = 0;
+		g_autofree gchar *data = NULL;
+		g_autofree gchar *fn = NULL;
+		g_autofree gchar *name = NULL;
+		g_autoptr(GError) error_local = NULL;
+
+		if (!g_str_has_suffix (filename, ".conf"))
+			continue;
+		name = g_strndup (filename, strlen (filename) - 5);
+		fn = g_build_filename (priv->directory, filename, NULL);
+		if (!acb_manifest_stat (fn, &mtime, &size))
+			continue;
+
+		/* unchanged since the index was written */
+		entry = acb_manifest_entry_new ();
+		entry->mtime = mtime;
+		entry->size = size;
+		if (g_key_file_get_int64 (index, name, "Mtime", NULL) == mtime &&
+		    g_key_file_get_int64 (index, name, "Size", NULL) == size)
+			data = g_key_file_get_string (index, name, "Data", NULL);
+		if (data != NULL &&
+		    g_key_file_load_from_data (entry->file, data, -1,
+					       G_KEY_FILE_KEEP_COMMENTS, NULL)) {
+			n_cached++;
+		} else if (!g_key_file_load_from_file (entry->file, fn,
+						       G_KEY_FILE_KEEP_COMMENTS,
+						       &error_local)) {
+			g_warning ("failed to read %s: %s", fn, error_local->message);
+			acb_manifest_entry_free (entry);
+			continue;
+		} else {
+			index_valid = FALSE;
+		}
+		g_hash_table_insert (priv->entries, g_steal_pointer (&name), entry);
+	}
+	g_debug ("loaded %u project configs, %u from the index",
+		 g_hash_table_size (priv->entries), n_cached);
+
+	/* projects were added, removed or edited */
+	if (!index_valid || n_groups != g_hash_table_size (priv->entries)) {
+		g_autoptr(GError) error_local = NULL;
+		if (!acb_manifest_save_index (manifest, &error_local))
+			g_warning ("failed to save index: %s", error_local->message);
+	}
+	return TRUE;
+}
+
+static gboolean
+acb_manifest_entry_has_groups (AcbManifestEntry *entry)
+{
+	gsize n_groups = 0;
+	g_strfreev (g_key_file_get_groups (entry->file, &n_groups));
+	return n_groups > 0;
+}
+
+static gboolean
+acb_manifest_save_entry (AcbManifest *manifest,
+			 const gchar *name,
+			 AcbManifestEntry *entry,
+			 GError **error)
+{
+	GHashTableIter iter;
+	gint64 mtime = 0;
+	gint64 size = 0;
+	gpointer key;
+	gpointer value;
+	g_autofree gchar *data = NULL;
+	g_autofree gchar *fn = NULL;
+
+	/* somebody edited the file while we were building */
+	fn = acb_manifest_get_filename (manifest, name);
+	if (acb_manifest_stat (fn, &mtime, &size) &&
+	    (mtime != entry->mtime || size != entry->size)) {
+		g_debug ("%s changed on disk, reloading", fn);
+		if (!g_key_file_load_from_file (entry->file, fn,
+						G_KEY_FILE_KEEP_COMMENTS, error))
+			return FALSE;
+	}
+
+	/* only a new file gets the header, setting a value creates the group */
+	if (!acb_manifest_entry_has_groups (entry)) {
+		if (!g_key_file_load_from_data (entry->file,
+						"#auto-generated\n\n[defaults]\n", -1,
+						G_KEY_FILE_KEEP_COMMENTS, error))
+			return FALSE;
+	}
+	g_hash_table_iter_init (&iter, entry->changed);
+	while (g_hash_table_iter_next (&iter, &key, &value))
+		g_key_file_set_value (entry->file, "defaults", key, value);
+
+	data = g_key_file_to_data (entry->file, NULL, error);
+	if (data == NULL)
+		return FALSE;
+	if (!g_file_set_contents (fn, data, -1, error))
+		return FALSE;
+	acb_manifest_stat (fn, &entry->mtime, &entry->size);
+	g_hash_table_remove_all (entry->changed);
+	return TRUE;
+}
+
+/* writes every project that was changed during the run in one go */
+gboolean
+acb_manifest_save (AcbManifest *manifest, GError **error)
+{
+	AcbManifestPrivate *priv = GET_PRIVATE (manifest);
+	GHashTableIter iter;
+	gboolean ret = TRUE;
+	gpointer key;
+	gpointer value;
+	guint n_saved = 0;
+
+	g_return_val_if_fail (ACB_IS_MANIFEST (manifest), FALSE);
+
+	g_mutex_lock (&priv->mutex);
+	g_hash_table_iter_init (&iter, priv->entries);
+	while (g_hash_table_iter_next (&iter, &key, &value)) {
+		AcbManifestEntry *entry = (AcbManifestEntry *) value;
+		if (g_hash_table_size (entry->changed) == 0)
+			continue;
+		ret = acb_manifest_save_entry (manifest, key, entry, error);
+		if (!ret)
+			break;
+		n_saved++;
+	}
+	if (ret && n_saved > 0) {
+		g_debug ("saved %u project configs", n_saved);
+		ret = acb_manifest_save_index (manifest, error);
+	}
+	g_mutex_unlock (&priv->mutex);
+	return ret;
+}
+
+/* for values that must not be lost if the run is interrupted */
+gboolean
+acb_manifest_save_project (AcbManifest *manifest, const gchar *name, GError **error)
+{
+	AcbManifestPrivate *priv = GET_PRIVATE (manifest);
+	AcbManifestEntry *entry;
+	gboolean ret = TRUE;
+
+	g_return_val_if_fail (ACB_IS_MANIFEST (manifest), FALSE);
+	g_return_val_if_fail (name != NULL, FALSE);
+
+	g_mutex_lock (&priv->mutex);
+	entry = g_hash_table_lookup (priv->entries, name);
+	if (entry != NULL && g_hash_table_size (entry->changed) > 0) {
+		ret = acb_manifest_save_entry (manifest, name, entry, error);
+		if (ret)
+			ret = acb_manifest_save_index (manifest, error);
+	}
+	g_mutex_unlock (&priv->mutex);
+	return ret;
+}
+
+/* in no particular order */
+GPtrArray *
+acb_manifest_get_names (AcbManifest *manifest)
+{
+	AcbManifestPrivate *priv = GET_PRIVATE (manifest);
+	GPtrArray *names;
+	GHashTableIter iter;
+	gpointer key;
+
+	g_return_val_if_fail (ACB_IS_MANIFEST (manifest), NULL);
+
+	names = g_ptr_array_new_with_free_func (g_free);
+	g_hash_table_iter_init (&iter, priv->entries);
+	while (g_hash_table_iter_next (&iter, &key, NULL))
+		g_ptr_array_add (names, g_strdup (key));
+	return names;
+}
+
+/* returns NULL if the project has no config file */
+GKeyFile *
+acb_manifest_get_project (AcbManifest *manifest, const gchar *name)
+{
+	AcbManifestPrivate *priv = GET_PRIVATE (manifest);
+	AcbManifestEntry *entry;
+
+	g_return_val_if_fail (ACB_IS_MANIFEST (manifest), NULL);
+	g_return_val_if_fail (name != NULL, NULL);
+
+	g_mutex_lock (&priv->mutex);
+	entry = g_hash_table_lookup (priv->entries, name);
+	g_mutex_unlock (&priv->mutex);
+	if (entry == NULL || entry->mtime == 0)
+		return NULL;
+	return entry->file;
+}
+
+/* the value is only written to disk by acb_manifest_save() or
+ * acb_manifest_save_project() */
+void
+acb_manifest_set_value (AcbManifest *manifest,
+			const gchar *name,
+			const gchar *key,
+			const gchar *value)
+{
+	AcbManifestPrivate *priv = GET_PRIVATE (manifest);
+	AcbManifestEntry *entry;
+
+	g_return_if_fail (ACB_IS_MANIFEST (manifest));
+	g_return_if_fail (name != NULL);
+	g_return_if_fail (key != NULL);
+	g_return_if_fail (value != NULL);
+
+	g_mutex_lock (&priv->mutex);
+	entry = g_hash_table_lookup (priv->entries, name);
+	if (entry == NULL) {
+		entry = acb_manifest_entry_new ();
+		g_hash_table_insert (priv->entries, g_strdup (name), entry);
+	}
+	g_hash_table_insert (entry->changed, g_strdup (key), g_strdup (value));
+	g_mutex_unlock (&priv->mutex);
+}
+
+static void
+acb_manifest_finalize (GObject *object)
+{
+	AcbManifest *manifest;
+	AcbManifestPrivate *priv;
+
+	g_return_if_fail (object != NULL);
+	g_return_if_fail (ACB_IS_MANIFEST (object));
+	manifest = ACB_MANIFEST (object);
+	priv = GET_PRIVATE (manifest);
+
+	g_free (priv->directory);
+	g_free (priv->index_fn);
+	g_hash_table_unref (priv->entries);
+	g_mutex_clear (&priv->mutex);
+
+	G_OBJECT_CLASS (acb_manifest_parent_class)->finalize (object);
+}
+
+static void
+acb_manifest_class_init (AcbManifestClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->finalize = acb_manifest_finalize;
+}
+
+static void
+acb_manifest_init (AcbManifest *manifest)
+{
+	AcbManifestPrivate *priv = GET_PRIVATE (manifest);
+	priv->directory = g_build_filename (g_get_user_data_dir (),
+					    "autocodebuild",
+					    NULL);
+	priv->index_fn = g_build_filename (g_get_user_cache_dir (),
+					   "autocodebuild",
+					   "manifest.ini",
+					   NULL);
+	priv->entries = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+					       (GDestroyNotify) acb_manifest_entry_free);
+	g_mutex_init (&priv->mutex);
+}
+
+AcbManifest *
+acb_manifest_new (void)
+{
+	AcbManifest *manifest;
+	manifest = g_object_new (ACB_TYPE_MANIFEST, NULL);
+	return ACB_MANIFEST (manifest);
+}
@@ -0,0 +1,55 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2018 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __ACB_MANIFEST_H
+#define __ACB_MANIFEST_H
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+#define ACB_TYPE_MANIFEST (acb_manifest_get_type ())
+G_DECLARE_DERIVABLE_TYPE (AcbManifest, acb_manifest, ACB, MANIFEST, GObject)
+
+struct _AcbManifestClass
+{
+	GObjectClass		parent_class;
+};
+
+AcbManifest	*acb_manifest_new			(void);
+gboolean	 acb_manifest_load			(AcbManifest		*manifest,
+							 GError			**error);
+gboolean	 acb_manifest_save			(AcbManifest		*manifest,
+							 GError			**error);
+gboolean	 acb_manifest_save_project		(AcbManifest		*manifest,
+							 const gchar		*name,
+							 GError			**error);
+GPtrArray	*acb_manifest_get_names			(AcbManifest		*manifest);
+GKeyFile	*acb_manifest_get_project		(AcbManifest		*manifest,
+							 const gchar		*name);
+void		 acb_manifest_set_value			(AcbManifest		*manifest,
+							 const gchar		*name,
+							 const gchar		*key,
+							 const gchar		*value);
+
+G_END_DECLS
+
+#endif /* __ACB_MANIFEST_H */
@@ -0,0 +1,331 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2018 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <glib.h>
+
+#include "acb-prefetch.h"
+#include "acb-spawn.h"
+
+/* fetches are network bound, so a few can run alongside the builds */
+#define ACB_PREFETCH_JOBS		4
+
+/* seconds between looking for projects that are due */
+#define ACB_PREFETCH_POLL		60
+
+typedef struct
+{
+	GThreadPool		*pool;
+	guint			 jobs;
+	guint			 poll_id;
+	GPtrArray		*projects;	/* of AcbProject */
+	GHashTable		*next;		/* AcbProject : gint64 unix time */
+	GHashTable		*fetching;	/* AcbProject */
+	GHashTable		*paused;	/* AcbProject */
+	AcbPrefetchFunc		 func;
+	gpointer		 func_data;
+	GMutex			 mutex;		/* for next and fetching */
+	GCond			 cond;
+} AcbPrefetchPrivate;
+
+typedef struct {
+	AcbPrefetch		*prefetch;
+	AcbProject		*project;
+	gboolean		 fetched;
+} AcbPrefetchHelper;
+
+G_DEFINE_TYPE_WITH_PRIVATE (AcbPrefetch, acb_prefetch, G_TYPE_OBJECT)
+
+#define GET_PRIVATE(o) (acb_prefetch_get_instance_private (o))
+
+void
+acb_prefetch_set_jobs (AcbPrefetch *prefetch, guint jobs)
+{
+	AcbPrefetchPrivate *priv = GET_PRIVATE (prefetch);
+	g_return_if_fail (ACB_IS_PREFETCH (prefetch));
+	g_return_if_fail (priv->pool == NULL);
+	priv->jobs = MAX (jobs, 1);
+}
+
+/* called in the main loop after each fetch */
+void
+acb_prefetch_set_func (AcbPrefetch *prefetch, AcbPrefetchFunc func, gpointer user_data)
+{
+	AcbPrefetchPrivate *priv = GET_PRIVATE (prefetch);
+	g_return_if_fail (ACB_IS_PREFETCH (prefetch));
+	priv->func = func;
+	priv->func_data = user_data;
+}
+
+void
+acb_prefetch_add_project (AcbPrefetch *prefetch, AcbProject *project)
+{
+	AcbPrefetchPrivate *priv = GET_PRIVATE (prefetch);
+	g_return_if_fail (ACB_IS_PREFETCH (prefetch));
+	g_return_if_fail (ACB_IS_PROJECT (project));
+	g_ptr_array_add (priv->projects, g_object_ref (project));
+}
+
+/* the project is being built, so leave the repo alone */
+void
+acb_prefetch_set_paused (AcbPrefetch *prefetch, AcbProject *project, gboolean paused)
+{
+	AcbPrefetchPrivate *priv = GET_PRIVATE (prefetch);
+	g_return_if_fail (ACB_IS_PREFETCH (prefetch));
+	if (paused)
+		g_hash_table_add (priv->paused, project);
+	else
+		g_hash_table_remove (priv->paused, project);
+}
+
+gboolean
+acb_prefetch_get_busy (AcbPrefetch *prefetch, AcbProject *project)
+{
+	AcbPrefetchPrivate *priv = GET_PRIVATE (prefetch);
+	gboolean ret;
+	g_return_val_if_fail (ACB_IS_PREFETCH (prefetch), FALSE);
+	g_mutex_lock (&priv->mutex);
+	ret = g_hash_table_contains (priv->fetching, project);
+	g_mutex_unlock (&priv->mutex);
+	return ret;
+}
+
+/* must be called with the mutex held */
+static gint64
+acb_prefetch_get_next (AcbPrefetch *prefetch, AcbProject *project)
+{
+	AcbPrefetchPrivate *priv = GET_PRIVATE (prefetch);
+	gint64 *next = g_hash_table_lookup (priv->next, project);
+	if (next != NULL)
+		return *next;
+	return acb_project_get_fetch_last (project) +
+	       acb_project_get_fetch_interval (project);
+}
+
+static gboolean
+acb_prefetch_done_cb (gpointer user_data)
+{
+	AcbPrefetchHelper *helper = (AcbPrefetchHelper *) user_data;
+	AcbPrefetchPrivate *priv = GET_PRIVATE (helper->prefetch);
+	if (priv->func != NULL)
+		priv->func (helper->project, helper->fetched, priv->func_data);
+	g_object_unref (helper->prefetch);
+	g_object_unref (helper->project);
+	g_free (helper);
+	return G_SOURCE_REMOVE;
+}
+
+static void
+acb_prefetch_worker_cb (gpointer data, gpointer user_data)
+{
+	AcbProject *project = ACB_PROJECT (data);
+	AcbPrefetch *prefetch = ACB_PREFETCH (user_data);
+	AcbPrefetchPrivate *priv = GET_PRIVATE (prefetch);
+	gboolean fetched = FALSE;
+	gboolean ret;
+	gint64 *next;
+	g_autoptr(GError) error = NULL;
+
+	/* only worth showing when something happened */
+	acb_project_set_buffered (project, TRUE);
+	ret = acb_project_prefetch (project, &fetched, &error);
+	if (!ret || fetched)
+		g_print ("%s", acb_project_get_output (project));
+	if (!ret)
+		g_print ("%s\n", error->message);
+	acb_project_set_buffered (project, FALSE);
+
+	/* a failure is retried on the same schedule */
+	next = g_new0 (gint64, 1);
+	*next = g_get_real_time () / G_USEC_PER_SEC +
+		acb_project_get_fetch_interval (project);
+	g_mutex_lock (&priv->mutex);
+	g_hash_table_insert (priv->next, project, next);
+	g_hash_table_remove (priv->fetching, project);
+	g_cond_broadcast (&priv->cond);
+	g_mutex_unlock (&priv->mutex);
+
+	/* nothing would run the idle without a main loop */
+	if (priv->func != NULL) {
+		AcbPrefetchHelper *helper = g_new0 (AcbPrefetchHelper, 1);
+		helper->prefetch = g_object_ref (prefetch);
+		helper->project = g_object_ref (project);
+		helper->fetched = ret && fetched;
+		g_idle_add (acb_prefetch_done_cb, helper);
+	}
+}
+
+/* paused projects are only checked from the main thread */
+static void
+acb_prefetch_dispatch (AcbPrefetch *prefetch)
+{
+	AcbPrefetchPrivate *priv = GET_PRIVATE (prefetch);
+	gint64 now = g_get_real_time () / G_USEC_PER_SEC;
+	guint i;
+
+	g_mutex_lock (&priv->mutex);
+	for (i = 0; i < priv->projects->len; i++) {
+		AcbProject *project = g_ptr_array_index (priv->projects, i);
+		if (acb_spawn_is_shutdown ())
+			break;
+		if (acb_project_get_disabled (project))
+			continue;
+		if (g_hash_table_contains (priv->fetching, project))
+			continue;
+		if (g_hash_table_contains (priv->paused, project))
+			continue;
+		if (acb_prefetch_get_next (prefetch, project) > now)
+			continue;
+		g_hash_table_add (priv->fetching, project);
+		g_thread_pool_push (priv->pool, project, NULL);
+	}
+	g_mutex_unlock (&priv->mutex);
+}
+
+static gboolean
+acb_prefetch_poll_cb (gpointer user_data)
+{
+	AcbPrefetch *prefetch = ACB_PREFETCH (user_data);
+	acb_prefetch_dispatch (prefetch);
+	return G_SOURCE_CONTINUE;
+}
+
+static gboolean
+acb_prefetch_ensure_pool (AcbPrefetch *prefetch, GError **error)
+{
+	AcbPrefetchPrivate *priv = GET_PRIVATE (prefetch);
+	if (priv->pool != NULL)
+		return TRUE;
+	priv->pool = g_thread_pool_new (acb_prefetch_worker_cb, prefetch,
+					(gint) priv->jobs, FALSE, error);
+	return priv->pool != NULL;
+}
+
+/* keeps fetching in the background while the main loop runs */
+gboolean
+acb_prefetch_start (AcbPrefetch *prefetch, GError **error)
+{
+	AcbPrefetchPrivate *priv = GET_PRIVATE (prefetch);
+
+	g_return_val_if_fail (ACB_IS_PREFETCH (prefetch), FALSE);
+	g_return_val_if_fail (priv->poll_id == 0, FALSE);
+
+	if (!acb_prefetch_ensure_pool (prefetch, error))
+		return FALSE;
+	acb_prefetch_dispatch (prefetch);
+	priv->poll_id = g_timeout_add_seconds (ACB_PREFETCH_POLL,
+					       acb_prefetch_poll_cb,
+					       prefetch);
+	return TRUE;
+}
+
+/* anything queued but not started is dropped */
+void
+acb_prefetch_stop (AcbPrefetch *prefetch)
+{
+	AcbPrefetchPrivate *priv = GET_PRIVATE (prefetch);
+
+	g_return_if_fail (ACB_IS_PREFETCH (prefetch));
+
+	if (priv->poll_id != 0) {
+		g_source_remove (priv->poll_id);
+		priv->poll_id = 0;
+	}
+	if (priv->pool != NULL) {
+		g_thread_pool_free (priv->pool, TRUE, TRUE);
+		priv->pool = NULL;
+	}
+	g_mutex_lock (&priv->mutex);
+	g_hash_table_remove_all (priv->fetching);
+	g_mutex_unlock (&priv->mutex);
+}
+
+/* fetches everything that is due, and waits for it to finish */
+gboolean
+acb_prefetch_run (AcbPrefetch *prefetch, GError **error)
+{
+	AcbPrefetchPrivate *priv = GET_PRIVATE (prefetch);
+
+	g_return_val_if_fail (ACB_IS_PREFETCH (prefetch), FALSE);
+
+	if (!acb_prefetch_ensure_pool (prefetch, error))
+		return FALSE;
+	acb_prefetch_dispatch (prefetch);
+	g_mutex_lock (&priv->mutex);
+	while (g_hash_table_size (priv->fetching) > 0)
+		g_cond_wait (&priv->cond, &priv->mutex);
+	g_mutex_unlock (&priv->mutex);
+	acb_prefetch_stop (prefetch);
+	return TRUE;
+}
+
+static void
+acb_prefetch_finalize (GObject *object)
+{
+	AcbPrefetch *prefetch;
+	AcbPrefetchPrivate *priv;
+
+	g_return_if_fail (object != NULL);
+	g_return_if_fail (ACB_IS_PREFETCH (object));
+	prefetch = ACB_PREFETCH (object);
+	priv = GET_PRIVATE (prefetch);
+
+	acb_prefetch_stop (prefetch);
+	g_ptr_array_unref (priv->projects);
+	g_hash_table_unref (priv->next);
+	g_hash_table_unref (priv->fetching);
+	g_hash_table_unref (priv->paused);
+	g_mutex_clear (&priv->mutex);
+	g_cond_clear (&priv->cond);
+
+	G_OBJECT_CLASS (acb_prefetch_parent_class)->finalize (object);
+}
+
+static void
+acb_prefetch_class_init (AcbPrefetchClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->finalize = acb_prefetch_finalize;
+}
+
+static void
+acb_prefetch_init (AcbPrefetch *prefetch)
+{
+	AcbPrefetchPrivate *priv = GET_PRIVATE (prefetch);
+	priv->jobs = ACB_PREFETCH_JOBS;
+	priv->projects = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	priv->next = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, g_free);
+	priv->fetching = g_hash_table_new (g_direct_hash, g_direct_equal);
+	priv->paused = g_hash_table_new (g_direct_hash, g_direct_equal);
+	g_mutex_init (&priv->mutex);
+	g_cond_init (&priv->cond);
+}
+
+AcbPrefetch *
+acb_prefetch_new (void)
+{
+	AcbPrefetch *prefetch;
+	prefetch = g_object_new (ACB_TYPE_PREFETCH, NULL);
+	return ACB_PREFETCH (prefetch);
+}
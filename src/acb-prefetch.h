@@ -0,0 +1,64 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2018 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __ACB_PREFETCH_H
+#define __ACB_PREFETCH_H
+
+#include <glib-object.h>
+
+#include "acb-project.h"
+
+G_BEGIN_DECLS
+
+#define ACB_TYPE_PREFETCH (acb_prefetch_get_type ())
+G_DECLARE_DERIVABLE_TYPE (AcbPrefetch, acb_prefetch, ACB, PREFETCH, GObject)
+
+struct _AcbPrefetchClass
+{
+	GObjectClass		parent_class;
+};
+
+typedef void	 (*AcbPrefetchFunc)			(AcbProject		*project,
+							 gboolean		 fetched,
+							 gpointer		 user_data);
+
+AcbPrefetch	*acb_prefetch_new			(void);
+void		 acb_prefetch_set_jobs			(AcbPrefetch		*prefetch,
+							 guint			 jobs);
+void		 acb_prefetch_set_func			(AcbPrefetch		*prefetch,
+							 AcbPrefetchFunc	 func,
+							 gpointer		 user_data);
+void		 acb_prefetch_add_project		(AcbPrefetch		*prefetch,
+							 AcbProject		*project);
+void		 acb_prefetch_set_paused		(AcbPrefetch		*prefetch,
+							 AcbProject		*project,
+							 gboolean		 paused);
+gboolean	 acb_prefetch_get_busy			(AcbPrefetch		*prefetch,
+							 AcbProject		*project);
+gboolean	 acb_prefetch_start			(AcbPrefetch		*prefetch,
+							 GError			**error);
+void		 acb_prefetch_stop			(AcbPrefetch		*prefetch);
+gboolean	 acb_prefetch_run			(AcbPrefetch		*prefetch,
+							 GError			**error);
+
+G_END_DECLS
+
+#endif /* __ACB_PREFETCH_H */
@@ -0,0 +1,245 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2018 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <errno.h>
+#include <sys/stat.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "acb-probe.h"
+
+typedef struct
+{
+	gchar			*filename;
+	GKeyFile		*file;		/* group per project */
+	gboolean		 changed;
+	GMutex			 mutex;		/* projects probe from worker threads */
+} AcbProbePrivate;
+
+G_DEFINE_TYPE_WITH_PRIVATE (AcbProbe, acb_probe, G_TYPE_OBJECT)
+
+#define GET_PRIVATE(o) (acb_probe_get_instance_private (o))
+
+/* a missing or corrupt cache just means everything is probed again */
+gboolean
+acb_probe_load (AcbProbe *probe, GError **error)
+{
+	AcbProbePrivate *priv = GET_PRIVATE (probe);
+	g_autoptr(GError) error_local = NULL;
+
+	g_return_val_if_fail (ACB_IS_PROBE (probe), FALSE);
+
+	if (!g_file_test (priv->filename, G_FILE_TEST_EXISTS))
+		return TRUE;
+	if (!g_key_file_load_from_file (priv->file, priv->filename,
+					G_KEY_FILE_NONE, &error_local)) {
+		g_warning ("ignoring %s: %s", priv->filename, error_local->message);
+		priv->changed = TRUE;
+	}
+	return TRUE;
+}
+
+gboolean
+acb_probe_save (AcbProbe *probe, GError **error)
+{
+	AcbProbePrivate *priv = GET_PRIVATE (probe);
+	g_autofree gchar *data = NULL;
+	g_autofree gchar *dirname = NULL;
+
+	g_return_val_if_fail (ACB_IS_PROBE (probe), FALSE);
+
+	if (!priv->changed)
+		return TRUE;
+	dirname = g_path_get_dirname (priv->filename);
+	if (g_mkdir_with_parents (dirname, 0755) != 0) {
+		g_set_error (error, 1, 0, "failed to create %s: %s",
+			     dirname, g_strerror (errno));
+		return FALSE;
+	}
+	g_mutex_lock (&priv->mutex);
+	data = g_key_file_to_data (priv->file, NULL, error);
+	priv->changed = FALSE;
+	g_mutex_unlock (&priv->mutex);
+	if (data == NULL)
+		return FALSE;
+	return g_file_set_contents (priv->filename, data, -1, error);
+}
+
+/* a file that is replaced, edited, created or deleted changes the stamp */
+gchar *
+acb_probe_get_stamp (const gchar **filenames)
+{
+	GString *stamp = g_string_new (NULL);
+	guint i;
+
+	for (i = 0; filenames[i] != NULL; i++) {
+		GStatBuf st;
+		if (stamp->len > 0)
+			g_string_append (stamp, ";");
+		if (g_stat (filenames[i], &st) != 0) {
+			g_string_append (stamp, "-");
+			continue;
+		}
+		g_string_append_printf (stamp, "%" G_GUINT64_FORMAT ":%" G_GINT64_FORMAT ".%09li:%" G_GINT64_FORMAT,
+					(guint64) st.st_ino,
+					(gint64) st.st_mtim.tv_sec,
+					(glong) st.st_mtim.tv_nsec,
+					(gint64) st.st_size);
+	}
+	return g_string_free (stamp, FALSE);
+}
+
+/* returns TRUE if the cached values for the project are still valid */
+gboolean
+acb_probe_lookup (AcbProbe *probe, const gchar *name, const gchar *stamp)
+{
+	AcbProbePrivate *priv = GET_PRIVATE (probe);
+	g_autofree gchar *stamp_old = NULL;
+
+	g_return_val_if_fail (ACB_IS_PROBE (probe), FALSE);
+	g_return_val_if_fail (name != NULL, FALSE);
+	g_return_val_if_fail (stamp != NULL, FALSE);
+
+	g_mutex_lock (&priv->mutex);
+	stamp_old = g_key_file_get_string (priv->file, name, "Stamp", NULL);
+	g_mutex_unlock (&priv->mutex);
+	return g_strcmp0 (stamp_old, stamp) == 0;
+}
+
+/* drops all the old values for the project */
+void
+acb_probe_reset (AcbProbe *probe, const gchar *name, const gchar *stamp)
+{
+	AcbProbePrivate *priv = GET_PRIVATE (probe);
+
+	g_return_if_fail (ACB_IS_PROBE (probe));
+	g_return_if_fail (name != NULL);
+	g_return_if_fail (stamp != NULL);
+
+	g_mutex_lock (&priv->mutex);
+	g_key_file_remove_group (priv->file, name, NULL);
+	g_key_file_set_string (priv->file, name, "Stamp", stamp);
+	priv->changed = TRUE;
+	g_mutex_unlock (&priv->mutex);
+}
+
+gchar *
+acb_probe_get_string (AcbProbe *probe, const gchar *name, const gchar *key)
+{
+	AcbProbePrivate *priv = GET_PRIVATE (probe);
+	gchar *value;
+	g_return_val_if_fail (ACB_IS_PROBE (probe), NULL);
+	g_mutex_lock (&priv->mutex);
+	value = g_key_file_get_string (priv->file, name, key, NULL);
+	g_mutex_unlock (&priv->mutex);
+	return value;
+}
+
+void
+acb_probe_set_string (AcbProbe *probe,
+		      const gchar *name,
+		      const gchar *key,
+		      const gchar *value)
+{
+	AcbProbePrivate *priv = GET_PRIVATE (probe);
+	g_return_if_fail (ACB_IS_PROBE (probe));
+	if (value == NULL)
+		return;
+	g_mutex_lock (&priv->mutex);
+	g_key_file_set_string (priv->file, name, key, value);
+	priv->changed = TRUE;
+	g_mutex_unlock (&priv->mutex);
+}
+
+gint
+acb_probe_get_integer (AcbProbe *probe, const gchar *name, const gchar *key)
+{
+	AcbProbePrivate *priv = GET_PRIVATE (probe);
+	gint value;
+	g_return_val_if_fail (ACB_IS_PROBE (probe), 0);
+	g_mutex_lock (&priv->mutex);
+	value = g_key_file_get_integer (priv->file, name, key, NULL);
+	g_mutex_unlock (&priv->mutex);
+	return value;
+}
+
+void
+acb_probe_set_integer (AcbProbe *probe,
+		       const gchar *name,
+		       const gchar *key,
+		       gint value)
+{
+	AcbProbePrivate *priv = GET_PRIVATE (probe);
+	g_return_if_fail (ACB_IS_PROBE (probe));
+	g_mutex_lock (&priv->mutex);
+	g_key_file_set_integer (priv->file, name, key, value);
+	priv->changed = TRUE;
+	g_mutex_unlock (&priv->mutex);
+}
+
+static void
+acb_probe_finalize (GObject *object)
+{
+	AcbProbe *probe;
+	AcbProbePrivate *priv;
+
+	g_return_if_fail (object != NULL);
+	g_return_if_fail (ACB_IS_PROBE (object));
+	probe = ACB_PROBE (object);
+	priv = GET_PRIVATE (probe);
+
+	g_free (priv->filename);
+	g_key_file_unref (priv->file);
+	g_mutex_clear (&priv->mutex);
+
+	G_OBJECT_CLASS (acb_probe_parent_class)->finalize (object);
+}
+
+static void
+acb_probe_class_init (AcbProbeClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->finalize = acb_probe_finalize;
+}
+
+static void
+acb_probe_init (AcbProbe *probe)
+{
+	AcbProbePrivate *priv = GET_PRIVATE (probe);
+	priv->filename = g_build_filename (g_get_user_cache_dir (),
+					   "autocodebuild",
+					   "probe.ini",
+					   NULL);
+	priv->file = g_key_file_new ();
+	g_mutex_init (&priv->mutex);
+}
+
+AcbProbe *
+acb_probe_new (void)
+{
+	AcbProbe *probe;
+	probe = g_object_new (ACB_TYPE_PROBE, NULL);
+	return ACB_PROBE (probe);
+}
@@ -0,0 +1,66 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2018 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __ACB_PROBE_H
+#define __ACB_PROBE_H
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+#define ACB_TYPE_PROBE (acb_probe_get_type ())
+G_DECLARE_DERIVABLE_TYPE (AcbProbe, acb_probe, ACB, PROBE, GObject)
+
+struct _AcbProbeClass
+{
+	GObjectClass		parent_class;
+};
+
+AcbProbe	*acb_probe_new				(void);
+gboolean	 acb_probe_load				(AcbProbe		*probe,
+							 GError			**error);
+gboolean	 acb_probe_save				(AcbProbe		*probe,
+							 GError			**error);
+gchar		*acb_probe_get_stamp			(const gchar		**filenames);
+gboolean	 acb_probe_lookup			(AcbProbe		*probe,
+							 const gchar		*name,
+							 const gchar		*stamp);
+void		 acb_probe_reset			(AcbProbe		*probe,
+							 const gchar		*name,
+							 const gchar		*stamp);
+gchar		*acb_probe_get_string			(AcbProbe		*probe,
+							 const gchar		*name,
+							 const gchar		*key);
+void		 acb_probe_set_string			(AcbProbe		*probe,
+							 const gchar		*name,
+							 const gchar		*key,
+							 const gchar		*value);
+gint		 acb_probe_get_integer			(AcbProbe		*probe,
+							 const gchar		*name,
+							 const gchar		*key);
+void		 acb_probe_set_integer			(AcbProbe		*probe,
+							 const gchar		*name,
+							 const gchar		*key,
+							 gint			 value);
+
+G_END_DECLS
+
+#endif /* __ACB_PROBE_H */
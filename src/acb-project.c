@@ -23,10 +23,24 @@
 #  include <config.h>
 #endif
 
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/statvfs.h>
 #include <glib.h>
 #include <glib/gstdio.h>
 
+#include "acb-backend.h"
+#include "acb-ccache.h"
+#include "acb-diffstat.h"
+#include "acb-file.h"
+#include "acb-jobserver.h"
+#include "acb-manifest.h"
+#include "acb-probe.h"
 #include "acb-project.h"
+#include "acb-spawn.h"
+#include "acb-target.h"
+#include "acb-template.h"
 #include "acb-common.h"
 
 #define ACB_PROJECT_GET_PRIVATE(o) (G_TYPE_INSTANCE_GET_PRIVATE ((o), ACB_TYPE_PROJECT, AcbProjectPrivate))
@@ -40,6 +54,14 @@ typedef enum
 	ACB_PROJECT_RCS_UNKNOWN
 } AcbProjectRcs;
 
+typedef enum {
+	ACB_PROJECT_PROBED_NONE		= 0,
+	ACB_PROJECT_PROBED_RCS		= 1 << 0,
+	ACB_PROJECT_PROBED_BACKEND	= 1 << 1,
+	ACB_PROJECT_PROBED_VERSION	= 1 << 2,
+	ACB_PROJECT_PROBED_LAST
+} AcbProjectProbed;
+
 typedef enum {
 	ACB_PROJECT_KIND_BUILDING_LOCALLY,
 	ACB_PROJECT_KIND_BUILDING_PACKAGE,
@@ -47,6 +69,10 @@ typedef enum {
 	ACB_PROJECT_KIND_CREATING_TARBALL,
 	ACB_PROJECT_KIND_CLEANING,
 	ACB_PROJECT_KIND_GARBAGE_COLLECTING,
+	ACB_PROJECT_KIND_COUNTING_OBJECTS,
+	ACB_PROJECT_KIND_REPACKING,
+	ACB_PROJECT_KIND_WRITING_COMMIT_GRAPH,
+	ACB_PROJECT_KIND_CHECKING_UPDATES,
 	ACB_PROJECT_KIND_GETTING_UPDATES,
 	ACB_PROJECT_KIND_SHOWING_UPDATES,
 	ACB_PROJECT_KIND_UPDATING,
@@ -62,16 +88,82 @@ typedef struct
 	gchar			*package_name;
 	gchar			*version;
 	gchar			*tarball_name;
+	gchar			**depends;
 	gboolean		 disabled;
-	gboolean		 use_ninja;
+	gboolean		 dist_tests;
+	AcbBackendKind		 backend;
+	gboolean		 has_changes;
+	gchar			*remote_head;	/* last one in the tree */
+	gchar			*remote_head_new;
+	gchar			*built_head;	/* last one built */
+	gchar			*fetch_head;	/* last one prefetched */
+	gchar			*tarball_cache;	/* last one cached */
+	gint64			 fetch_last;	/* unix time */
+	guint			 fetch_interval;	/* seconds */
+	guint			 gc_max_loose;
+	guint			 gc_max_packs;
+	guint			 gc_aggressive_days;
+	gint64			 gc_aggressive_last;	/* unix time */
+	gchar			*scratch_dir;	/* fast local disk, or NULL */
+	guint64			 scratch_min_size;	/* bytes */
+	guint			 loose_objects;
+	guint			 packs;
 	guint			 release;
 	AcbProjectRcs		 rcs;
+	AcbProjectProbed	 probed;
+	AcbJobserver		*jobserver;
+	AcbCcache		*ccache;
+	AcbManifest		*manifest;
+	AcbProbe		*probe;		/* or NULL to always probe */
+	GString			*output;
+	GPtrArray		*stats;		/* of AcbStats */
+	GHashTable		*timeouts;	/* kind id : seconds */
+	GHashTable		*variables;	/* for the .spec.in */
+	AcbTemplate		*spec_template;
+	GPtrArray		*targets;	/* of AcbTarget */
+	GMutex			 mutex;		/* for output and stats */
 } AcbProjectPrivate;
 
 G_DEFINE_TYPE_WITH_PRIVATE (AcbProject, acb_project, G_TYPE_OBJECT)
 
 #define GET_PRIVATE(o) (acb_project_get_instance_private (o))
 
+/* the same as the git gc.auto and gc.autoPackLimit defaults */
+#define ACB_PROJECT_GC_MAX_LOOSE	6700
+#define ACB_PROJECT_GC_MAX_PACKS	50
+#define ACB_PROJECT_GC_AGGRESSIVE_DAYS	30
+
+/* in seconds, and can be overridden in the [timeouts] group */
+#define ACB_PROJECT_TIMEOUT_NETWORK	1800
+
+/* in seconds, busy projects are fetched more often than quiet ones */
+#define ACB_PROJECT_FETCH_INTERVAL_MIN	(5 * 60)
+#define ACB_PROJECT_FETCH_INTERVAL	(60 * 60)
+#define ACB_PROJECT_FETCH_INTERVAL_MAX	(24 * 60 * 60)
+
+/* the BUILD and BUILDROOT of a big project can easily use this much */
+#define ACB_PROJECT_SCRATCH_MIN_SIZE	"4G"
+
+void
+acb_project_print (AcbProject *project, const gchar *format, ...)
+{
+	AcbProjectPrivate *priv = GET_PRIVATE (project);
+	va_list args;
+	g_autofree gchar *str = NULL;
+
+	va_start (args, format);
+	str = g_strdup_vprintf (format, args);
+	va_end (args);
+
+	/* save for later so output from other projects is not interleaved */
+	g_mutex_lock (&priv->mutex);
+	if (priv->output != NULL)
+		g_string_append (priv->output, str);
+	else
+		g_print ("%s", str);
+	g_mutex_unlock (&priv->mutex);
+}
+
 static gboolean
 acb_project_path_suffix_exists (AcbProject *project, const gchar *suffix)
 {
@@ -84,69 +176,155 @@ acb_project_path_suffix_exists (AcbProject *project, const gchar *suffix)
 	return ret;
 }
 
+/* the changes are saved for all projects at the end of the run */
 static gboolean
 acb_project_write_conf (AcbProject *project, GError **error)
 {
 	AcbProjectPrivate *priv = GET_PRIVATE (project);
-	g_autofree gchar *data = NULL;
-	g_autofree gchar *defaults = NULL;
-	g_autoptr(GKeyFile) file = NULL;
+	g_autofree gchar *release = NULL;
+
+	release = g_strdup_printf ("%u", priv->release);
+	acb_manifest_set_value (priv->manifest, priv->package_name, "Release", release);
+	if (priv->remote_head != NULL) {
+		acb_manifest_set_value (priv->manifest, priv->package_name,
+					"RemoteHead", priv->remote_head);
+	}
+	if (priv->built_head != NULL) {
+		acb_manifest_set_value (priv->manifest, priv->package_name,
+					"BuiltHead", priv->built_head);
+	}
+	if (priv->gc_aggressive_last > 0) {
+		g_autofree gchar *last = NULL;
+		last = g_strdup_printf ("%" G_GINT64_FORMAT, priv->gc_aggressive_last);
+		acb_manifest_set_value (priv->manifest, priv->package_name,
+					"GcAggressiveLast", last);
+	}
+	if (priv->fetch_last > 0) {
+		g_autofree gchar *last = NULL;
+		g_autofree gchar *interval = NULL;
+		last = g_strdup_printf ("%" G_GINT64_FORMAT, priv->fetch_last);
+		interval = g_strdup_printf ("%u", priv->fetch_interval);
+		acb_manifest_set_value (priv->manifest, priv->package_name,
+					"FetchLast", last);
+		acb_manifest_set_value (priv->manifest, priv->package_name,
+					"FetchInterval", interval);
+	}
+	if (priv->fetch_head != NULL) {
+		acb_manifest_set_value (priv->manifest, priv->package_name,
+					"FetchHead", priv->fetch_head);
+	}
+	if (priv->tarball_cache != NULL) {
+		acb_manifest_set_value (priv->manifest, priv->package_name,
+					"TarballCache", priv->tarball_cache);
+	}
+	return TRUE;
+}
 
-	/* load file */
-	file = g_key_file_new ();
-	defaults = g_strdup_printf ("%s/autocodebuild/%s.conf",
-				    g_get_user_data_dir (),
-				    priv->package_name);
+static void
+acb_project_load_timeouts (AcbProject *project, GKeyFile *file)
+{
+	AcbProjectPrivate *priv = GET_PRIVATE (project);
+	guint i;
+	g_auto(GStrv) keys = NULL;
 
-	/* does not yet exist */
-	if (!g_file_test (defaults, G_FILE_TEST_EXISTS)) {
-		if (!g_file_set_contents (defaults, "#auto-generated\n\n[defaults]\n", -1, error))
-			return FALSE;
+	/* keys are the same as the logfile suffix, and are in seconds */
+	keys = g_key_file_get_keys (file, "timeouts", NULL, NULL);
+	if (keys == NULL)
+		return;
+	for (i = 0; keys[i] != NULL; i++) {
+		gint timeout = g_key_file_get_integer (file, "timeouts", keys[i], NULL);
+		g_hash_table_insert (priv->timeouts,
+				     g_strdup (keys[i]),
+				     GUINT_TO_POINTER ((guint) MAX (timeout, 0)));
 	}
+}
 
-	/* load latest copy */
-	if (!g_key_file_load_from_file (file, defaults, G_KEY_FILE_NONE, error))
-		return FALSE;
+static void
+acb_project_load_gc_policy (AcbProject *project, GKeyFile *file)
+{
+	AcbProjectPrivate *priv = GET_PRIVATE (project);
 
-	/* set new value */
-	g_key_file_set_integer (file, "defaults", "Release", priv->release);
+	if (g_key_file_has_key (file, "defaults", "GcMaxLooseObjects", NULL))
+		priv->gc_max_loose = (guint) MAX (g_key_file_get_integer (file, "defaults", "GcMaxLooseObjects", NULL), 0);
+	if (g_key_file_has_key (file, "defaults", "GcMaxPacks", NULL))
+		priv->gc_max_packs = (guint) MAX (g_key_file_get_integer (file, "defaults", "GcMaxPacks", NULL), 0);
+	if (g_key_file_has_key (file, "defaults", "GcAggressiveDays", NULL))
+		priv->gc_aggressive_days = (guint) MAX (g_key_file_get_integer (file, "defaults", "GcAggressiveDays", NULL), 0);
+}
 
-	/* push to text */
-	data = g_key_file_to_data (file, NULL, error);
-	if (data == NULL)
-		return FALSE;
+/* accepts a plain number of bytes, or a K, M, G or T suffix */
+static guint64
+acb_project_parse_size (const gchar *str)
+{
+	gchar *endptr = NULL;
+	guint64 size = g_ascii_strtoull (str, &endptr, 10);
+	switch (g_ascii_toupper (endptr[0])) {
+	case 'T':
+		size *= 1024;
+		/* fall through */
+	case 'G':
+		size *= 1024;
+		/* fall through */
+	case 'M':
+		size *= 1024;
+		/* fall through */
+	case 'K':
+		size *= 1024;
+		break;
+	default:
+		break;
+	}
+	return size;
+}
+
+static void
+acb_project_load_scratch (AcbProject *project, GKeyFile *file)
+{
+	AcbProjectPrivate *priv = GET_PRIVATE (project);
+	g_autofree gchar *min_size = NULL;
+
+	if (g_key_file_has_key (file, "defaults", "ScratchDir", NULL)) {
+		g_free (priv->scratch_dir);
+		priv->scratch_dir = g_key_file_get_string (file, "defaults", "ScratchDir", NULL);
+		if (priv->scratch_dir != NULL && priv->scratch_dir[0] == '\0')
+			g_clear_pointer (&priv->scratch_dir, g_free);
+	}
+	min_size = g_key_file_get_string (file, "defaults", "ScratchMinSize", NULL);
+	if (min_size != NULL)
+		priv->scratch_min_size = acb_project_parse_size (min_size);
+}
+
+static void
+acb_project_load_variables (AcbProject *project, GKeyFile *file)
+{
+	AcbProjectPrivate *priv = GET_PRIVATE (project);
+	guint i;
+	g_auto(GStrv) keys = NULL;
 
-	/* save to file */
-	return g_file_set_contents (defaults, data, -1, error);
+	/* any extra #KEY# substitutions for the spec file */
+	keys = g_key_file_get_keys (file, "variables", NULL, NULL);
+	if (keys == NULL)
+		return;
+	for (i = 0; keys[i] != NULL; i++) {
+		g_hash_table_insert (priv->variables,
+				     g_strdup (keys[i]),
+				     g_key_file_get_string (file, "variables", keys[i], NULL));
+	}
 }
 
 static gboolean
 acb_project_load_defaults (AcbProject *project)
 {
 	AcbProjectPrivate *priv = GET_PRIVATE (project);
-	gboolean ret;
-	g_autofree gchar *defaults;
-	g_autoptr(GError) error = NULL;
-	g_autoptr(GKeyFile) file = NULL;
-
-	/* find file, but it's okay not to have a file if the defaults are okay */
-	defaults = g_strdup_printf ("%s/%s/%s.conf",
-				    g_get_user_data_dir (),
-				    "autocodebuild",
-				    priv->package_name);
-	if (!g_file_test (defaults, G_FILE_TEST_EXISTS)) {
-		g_debug ("no %s file, creating", defaults);
-		ret = acb_project_write_conf (project, &error);
-		if (!ret)
-			g_warning ("failed to write: %s", error->message);
-		return ret;
-	}
+	GKeyFile *file;
+	guint i;
+	g_autofree gchar *backend = NULL;
 
-	/* load file */
-	file = g_key_file_new ();
-	if (!g_key_file_load_from_file (file, defaults, G_KEY_FILE_NONE, &error)) {
-		g_warning ("failed to read: %s", error->message);
-		return FALSE;
+	/* it's okay not to have a file if the defaults are okay */
+	file = acb_manifest_get_project (priv->manifest, priv->package_name);
+	if (file == NULL) {
+		g_debug ("no config for %s, creating", priv->package_name);
+		return acb_project_write_conf (project, NULL);
 	}
 
 	/* get values */
@@ -156,13 +334,37 @@ acb_project_load_defaults (AcbProject *project)
 	priv->disabled = g_key_file_get_boolean (file, "defaults", "Disabled", NULL);
 	priv->release = g_key_file_get_integer (file, "defaults", "Release", NULL);
 	priv->path = g_key_file_get_string (file, "defaults", "Path", NULL);
-	return ret;
+	priv->depends = g_key_file_get_string_list (file, "defaults", "Depends", NULL, NULL);
+	priv->dist_tests = g_key_file_get_boolean (file, "defaults", "DistTests", NULL);
+	backend = g_key_file_get_string (file, "defaults", "Backend", NULL);
+	for (i = ACB_BACKEND_KIND_UNKNOWN + 1; backend != NULL && i < ACB_BACKEND_KIND_LAST; i++) {
+		if (g_strcmp0 (backend, acb_backend_kind_to_string (i)) == 0)
+			priv->backend = i;
+	}
+	priv->remote_head = g_key_file_get_string (file, "defaults", "RemoteHead", NULL);
+	priv->built_head = g_key_file_get_string (file, "defaults", "BuiltHead", NULL);
+	if (priv->built_head == NULL)
+		priv->built_head = g_strdup (priv->remote_head);
+	priv->gc_aggressive_last = g_key_file_get_int64 (file, "defaults", "GcAggressiveLast", NULL);
+	priv->fetch_head = g_key_file_get_string (file, "defaults", "FetchHead", NULL);
+	priv->tarball_cache = g_key_file_get_string (file, "defaults", "TarballCache", NULL);
+	priv->fetch_last = g_key_file_get_int64 (file, "defaults", "FetchLast", NULL);
+	if (g_key_file_has_key (file, "defaults", "FetchInterval", NULL)) {
+		gint interval = g_key_file_get_integer (file, "defaults", "FetchInterval", NULL);
+		priv->fetch_interval = CLAMP (interval,
+					      ACB_PROJECT_FETCH_INTERVAL_MIN,
+					      ACB_PROJECT_FETCH_INTERVAL_MAX);
+	}
+	acb_project_load_timeouts (project, file);
+	acb_project_load_gc_policy (project, file);
+	acb_project_load_scratch (project, file);
+	acb_project_load_variables (project, file);
+	return TRUE;
 }
 
-static gboolean
-acb_project_get_from_config_h (AcbProject *project)
+static gchar *
+acb_project_get_version_from_config_h (const gchar *path_build)
 {
-	AcbProjectPrivate *priv = GET_PRIVATE (project);
 	gchar *ptr;
 	guint i;
 	g_autofree gchar *configh = NULL;
@@ -170,13 +372,13 @@ acb_project_get_from_config_h (AcbProject *project)
 	g_auto(GStrv) split = NULL;
 
 	/* find file */
-	configh = g_build_filename (priv->path_build, "config.h", NULL);
+	configh = g_build_filename (path_build, "config.h", NULL);
 	if (!g_file_test (configh, G_FILE_TEST_EXISTS))
-		return TRUE;
+		return NULL;
 
 	/* get contents */
 	if (!g_file_get_contents (configh, &contents, NULL, NULL))
-		return FALSE;
+		return NULL;
 
 	/* split into lines */
 	split = g_strsplit (contents, "\n", -1);
@@ -186,57 +388,204 @@ acb_project_get_from_config_h (AcbProject *project)
 			continue;
 		if (g_str_has_prefix (ptr, "#define ")) {
 			ptr += 8;
-			if (priv->version == NULL &&
-			    g_str_has_prefix (ptr, "PACKAGE_VERSION")) {
+			if (g_str_has_prefix (ptr, "PACKAGE_VERSION")) {
 				ptr += 16;
 				g_strdelimit (ptr, "\"", ' ');
 				g_strstrip (ptr);
-				priv->version = g_strdup (ptr);
+				return g_strdup (ptr);
 			}
-			if (priv->version == NULL &&
-			    g_str_has_prefix (ptr, "VERSION")) {
+			if (g_str_has_prefix (ptr, "VERSION")) {
 				ptr += 8;
 				g_strdelimit (ptr, "\"", ' ');
 				g_strstrip (ptr);
-				priv->version = g_strdup (ptr);
+				return g_strdup (ptr);
 			}
 		}
 	}
-	return TRUE;
+	return NULL;
 }
 
-static gboolean
-acb_project_get_from_meson (AcbProject *project)
+static gchar *
+acb_project_get_version_from_meson (const gchar *path)
 {
-	AcbProjectPrivate *priv = GET_PRIVATE (project);
 	guint i;
 	g_autofree gchar *configh = NULL;
 	g_autofree gchar *contents = NULL;
 	g_auto(GStrv) split = NULL;
 
 	/* find file */
-	configh = g_build_filename (priv->path, "meson.build", NULL);
+	configh = g_build_filename (path, "meson.build", NULL);
 	if (!g_file_test (configh, G_FILE_TEST_EXISTS))
-		return TRUE;
+		return NULL;
 
 	/* get contents */
 	if (!g_file_get_contents (configh, &contents, NULL, NULL))
-		return FALSE;
+		return NULL;
 
 	/* split into lines */
 	split = g_strsplit (contents, "\n", -1);
 	for (i = 0; split[i] != NULL; i++) {
 		gchar *tmp;
+		gchar *version;
 		if (split[i][0] == '\0')
 			continue;
 		tmp = g_strstr_len (split[i], -1, "version : '");
 		if (tmp == NULL)
 			continue;
-		priv->version = g_strdup (tmp + 11);
-		g_strdelimit (priv->version, "'", '\0');
-		break;
+		version = g_strdup (tmp + 11);
+		g_strdelimit (version, "'", '\0');
+		return version;
 	}
-	return TRUE;
+	return NULL;
+}
+
+static AcbProjectRcs
+acb_project_detect_rcs (AcbProject *project)
+{
+	if (acb_project_path_suffix_exists (project, ".git"))
+		return ACB_PROJECT_RCS_GIT;
+	if (acb_project_path_suffix_exists (project, ".svn"))
+		return ACB_PROJECT_RCS_SVN;
+	if (acb_project_path_suffix_exists (project, "CVS"))
+		return ACB_PROJECT_RCS_CVS;
+	if (acb_project_path_suffix_exists (project, ".bzr"))
+		return ACB_PROJECT_RCS_BZR;
+	return ACB_PROJECT_RCS_UNKNOWN;
+}
+
+/* reading the tree is slow, so values are reused until one of the files changes */
+static gchar *
+acb_project_get_probe_stamp (AcbProject *project, const gchar *prefix, ...)
+{
+	AcbProjectPrivate *priv = GET_PRIVATE (project);
+	const gchar *filename;
+	va_list args;
+	g_autofree gchar *stamp_files = NULL;
+	g_autoptr(GPtrArray) filenames = NULL;
+
+	if (priv->probe == NULL)
+		return NULL;
+	filenames = g_ptr_array_new_with_free_func (g_free);
+	va_start (args, prefix);
+	while ((filename = va_arg (args, const gchar *)) != NULL)
+		g_ptr_array_add (filenames, g_build_filename (priv->path, filename, NULL));
+	va_end (args);
+	g_ptr_array_add (filenames, NULL);
+	stamp_files = acb_probe_get_stamp ((const gchar **) filenames->pdata);
+	return g_strdup_printf ("%s;%s", prefix, stamp_files);
+}
+
+/* the RCS is found from the top level entries */
+static AcbProjectRcs
+acb_project_get_rcs (AcbProject *project)
+{
+	AcbProjectPrivate *priv = GET_PRIVATE (project);
+	g_autofree gchar *group = NULL;
+	g_autofree gchar *stamp = NULL;
+
+	if (priv->probed & ACB_PROJECT_PROBED_RCS)
+		return priv->rcs;
+	group = g_strdup_printf ("%s rcs", priv->package_name);
+	/* only files that are rarely rewritten, not the top level directory,
+	 * which changes every time a tarball is written */
+	stamp = acb_project_get_probe_stamp (project, "",
+					     ".git/HEAD", ".svn/wc.db", "CVS/Root",
+					     ".bzr/branch-format", NULL);
+	if (stamp != NULL && acb_probe_lookup (priv->probe, group, stamp)) {
+		priv->rcs = acb_probe_get_integer (priv->probe, group, "Rcs");
+	} else {
+		priv->rcs = acb_project_detect_rcs (project);
+		if (stamp != NULL) {
+			acb_probe_reset (priv->probe, group, stamp);
+			acb_probe_set_integer (priv->probe, group, "Rcs", priv->rcs);
+		}
+	}
+	priv->probed |= ACB_PROJECT_PROBED_RCS;
+	return priv->rcs;
+}
+
+/* so is the build system, unless Backend= was set */
+static AcbBackendKind
+acb_project_get_backend (AcbProject *project)
+{
+	AcbProjectPrivate *priv = GET_PRIVATE (project);
+	g_autofree gchar *group = NULL;
+	g_autofree gchar *stamp = NULL;
+
+	if (priv->probed & ACB_PROJECT_PROBED_BACKEND)
+		return priv->backend;
+	if (priv->backend == ACB_BACKEND_KIND_UNKNOWN) {
+		group = g_strdup_printf ("%s backend", priv->package_name);
+		stamp = acb_project_get_probe_stamp (project, "",
+						     "meson.build", "CMakeLists.txt",
+						     "configure.ac", "configure.in",
+						     "Makefile", NULL);
+		if (stamp != NULL && acb_probe_lookup (priv->probe, group, stamp)) {
+			priv->backend = acb_probe_get_integer (priv->probe, group, "Backend");
+		} else {
+			priv->backend = acb_backend_detect (priv->path);
+			if (stamp != NULL) {
+				acb_probe_reset (priv->probe, group, stamp);
+				acb_probe_set_integer (priv->probe, group, "Backend", priv->backend);
+			}
+		}
+	}
+	priv->path_build = acb_backend_get_build_dir (priv->backend, priv->path);
+	g_debug ("using %s backend in %s",
+		 acb_backend_kind_to_string (priv->backend), priv->path_build);
+	priv->probed |= ACB_PROJECT_PROBED_BACKEND;
+	return priv->backend;
+}
+
+static const gchar *
+acb_project_get_path_build (AcbProject *project)
+{
+	AcbProjectPrivate *priv = GET_PRIVATE (project);
+	acb_project_get_backend (project);
+	return priv->path_build;
+}
+
+/* meson.build wins over the project config, which wins over config.h */
+static const gchar *
+acb_project_get_version (AcbProject *project)
+{
+	AcbProjectPrivate *priv = GET_PRIVATE (project);
+	AcbBackendKind backend;
+	g_autofree gchar *group = NULL;
+	g_autofree gchar *stamp = NULL;
+	g_autofree gchar *version_configh = NULL;
+	g_autofree gchar *version_meson = NULL;
+
+	if (priv->probed & ACB_PROJECT_PROBED_VERSION)
+		return priv->version;
+
+	/* config.h is in the build dir */
+	backend = acb_project_get_backend (project);
+	group = g_strdup_printf ("%s version", priv->package_name);
+	stamp = acb_project_get_probe_stamp (project,
+					     acb_backend_kind_to_string (backend),
+					     "meson.build", "config.h", "build/config.h", NULL);
+	if (stamp != NULL && acb_probe_lookup (priv->probe, group, stamp)) {
+		version_configh = acb_probe_get_string (priv->probe, group, "VersionConfigH");
+		version_meson = acb_probe_get_string (priv->probe, group, "VersionMeson");
+	} else {
+		version_configh = acb_project_get_version_from_config_h (acb_project_get_path_build (project));
+		version_meson = acb_project_get_version_from_meson (priv->path);
+		if (stamp != NULL) {
+			acb_probe_reset (priv->probe, group, stamp);
+			acb_probe_set_string (priv->probe, group, "VersionConfigH", version_configh);
+			acb_probe_set_string (priv->probe, group, "VersionMeson", version_meson);
+		}
+	}
+	if (priv->version == NULL)
+		priv->version = g_steal_pointer (&version_configh);
+	if (version_meson != NULL) {
+		g_free (priv->version);
+		priv->version = g_steal_pointer (&version_meson);
+	}
+	g_debug ("version:      %s", priv->version);
+	priv->probed |= ACB_PROJECT_PROBED_VERSION;
+	return priv->version;
 }
 
 void
@@ -251,6 +600,58 @@ acb_project_set_rpmbuild_path (AcbProject *project, const gchar *path)
 	priv->rpmbuild_path = g_strdup (path);
 }
 
+void
+acb_project_set_jobserver (AcbProject *project, AcbJobserver *jobserver)
+{
+	AcbProjectPrivate *priv = GET_PRIVATE (project);
+	g_return_if_fail (ACB_IS_PROJECT (project));
+	g_set_object (&priv->jobserver, jobserver);
+}
+
+/* the global settings, which the project .conf file can override */
+void
+acb_project_set_defaults (AcbProject *project, GKeyFile *defaults)
+{
+	g_return_if_fail (ACB_IS_PROJECT (project));
+	acb_project_load_timeouts (project, defaults);
+	acb_project_load_gc_policy (project, defaults);
+	acb_project_load_scratch (project, defaults);
+}
+
+void
+acb_project_set_targets (AcbProject *project, GPtrArray *targets)
+{
+	AcbProjectPrivate *priv = GET_PRIVATE (project);
+	g_return_if_fail (ACB_IS_PROJECT (project));
+	g_return_if_fail (targets != NULL && targets->len > 0);
+	g_ptr_array_unref (priv->targets);
+	priv->targets = g_ptr_array_ref (targets);
+}
+
+void
+acb_project_set_ccache (AcbProject *project, AcbCcache *ccache)
+{
+	AcbProjectPrivate *priv = GET_PRIVATE (project);
+	g_return_if_fail (ACB_IS_PROJECT (project));
+	g_set_object (&priv->ccache, ccache);
+}
+
+void
+acb_project_set_manifest (AcbProject *project, AcbManifest *manifest)
+{
+	AcbProjectPrivate *priv = GET_PRIVATE (project);
+	g_return_if_fail (ACB_IS_PROJECT (project));
+	g_set_object (&priv->manifest, manifest);
+}
+
+void
+acb_project_set_probe (AcbProject *project, AcbProbe *probe)
+{
+	AcbProjectPrivate *priv = GET_PRIVATE (project);
+	g_return_if_fail (ACB_IS_PROJECT (project));
+	g_set_object (&priv->probe, probe);
+}
+
 void
 acb_project_set_default_code_path (AcbProject *project, const gchar *path)
 {
@@ -263,15 +664,140 @@ acb_project_set_default_code_path (AcbProject *project, const gchar *path)
 	priv->default_code_path = g_strdup (path);
 }
 
+const gchar *
+acb_project_get_name (AcbProject *project)
+{
+	AcbProjectPrivate *priv = GET_PRIVATE (project);
+	g_return_val_if_fail (ACB_IS_PROJECT (project), NULL);
+	return priv->package_name;
+}
+
+const gchar *
+acb_project_get_path (AcbProject *project)
+{
+	AcbProjectPrivate *priv = GET_PRIVATE (project);
+	g_return_val_if_fail (ACB_IS_PROJECT (project), NULL);
+	return priv->path;
+}
+
+gchar **
+acb_project_get_depends (AcbProject *project)
+{
+	AcbProjectPrivate *priv = GET_PRIVATE (project);
+	g_return_val_if_fail (ACB_IS_PROJECT (project), NULL);
+	return priv->depends;
+}
+
+gboolean
+acb_project_get_disabled (AcbProject *project)
+{
+	AcbProjectPrivate *priv = GET_PRIVATE (project);
+	g_return_val_if_fail (ACB_IS_PROJECT (project), FALSE);
+	return priv->disabled;
+}
+
+void
+acb_project_set_buffered (AcbProject *project, gboolean buffered)
+{
+	AcbProjectPrivate *priv = GET_PRIVATE (project);
+
+	g_return_if_fail (ACB_IS_PROJECT (project));
+
+	/* anything from a previous run has already been shown */
+	if (buffered && priv->output == NULL)
+		priv->output = g_string_new (NULL);
+	else if (buffered)
+		g_string_truncate (priv->output, 0);
+	else if (!buffered && priv->output != NULL) {
+		g_string_free (priv->output, TRUE);
+		priv->output = NULL;
+	}
+}
+
+/* every stage worked, so a failed build is retried until it does */
+void
+acb_project_set_built (AcbProject *project)
+{
+	AcbProjectPrivate *priv = GET_PRIVATE (project);
+
+	g_return_if_fail (ACB_IS_PROJECT (project));
+
+	if (priv->remote_head == NULL ||
+	    g_strcmp0 (priv->built_head, priv->remote_head) == 0)
+		return;
+	g_free (priv->built_head);
+	priv->built_head = g_strdup (priv->remote_head);
+	acb_project_write_conf (project, NULL);
+}
+
+/* the daemon reuses the project, and the tree may have changed since */
+void
+acb_project_reset (AcbProject *project)
+{
+	AcbProjectPrivate *priv = GET_PRIVATE (project);
+
+	g_return_if_fail (ACB_IS_PROJECT (project));
+
+	priv->probed = 0;
+	g_mutex_lock (&priv->mutex);
+	g_ptr_array_set_size (priv->stats, 0);
+	g_mutex_unlock (&priv->mutex);
+}
+
+/* when the last background fetch finished, or 0 for never */
+gint64
+acb_project_get_fetch_last (AcbProject *project)
+{
+	AcbProjectPrivate *priv = GET_PRIVATE (project);
+	g_return_val_if_fail (ACB_IS_PROJECT (project), 0);
+	return priv->fetch_last;
+}
+
+/* how long to wait before the next background fetch, in seconds */
+guint
+acb_project_get_fetch_interval (AcbProject *project)
+{
+	AcbProjectPrivate *priv = GET_PRIVATE (project);
+	g_return_val_if_fail (ACB_IS_PROJECT (project), 0);
+	return priv->fetch_interval;
+}
+
+/* if the update found anything new upstream, or TRUE if unknown */
+gboolean
+acb_project_get_has_changes (AcbProject *project)
+{
+	AcbProjectPrivate *priv = GET_PRIVATE (project);
+	g_return_val_if_fail (ACB_IS_PROJECT (project), FALSE);
+	return priv->has_changes;
+}
+
+GPtrArray *
+acb_project_get_stats (AcbProject *project)
+{
+	AcbProjectPrivate *priv = GET_PRIVATE (project);
+	g_return_val_if_fail (ACB_IS_PROJECT (project), NULL);
+	return priv->stats;
+}
+
+const gchar *
+acb_project_get_output (AcbProject *project)
+{
+	AcbProjectPrivate *priv = GET_PRIVATE (project);
+	g_return_val_if_fail (ACB_IS_PROJECT (project), NULL);
+	if (priv->output == NULL)
+		return NULL;
+	return priv->output->str;
+}
+
 void
 acb_project_set_name (AcbProject *project, const gchar *name)
 {
 	AcbProjectPrivate *priv = GET_PRIVATE (project);
 	g_autofree gchar *defaults = NULL;
-	g_autofree gchar *path_build = NULL;
 
 	g_return_if_fail (ACB_IS_PROJECT (project));
 	g_return_if_fail (name != NULL);
+	g_return_if_fail (priv->manifest != NULL);
 
 	g_free (priv->package_name);
 	priv->package_name = g_strdup (name);
@@ -292,45 +818,21 @@ acb_project_set_name (AcbProject *project, const gchar *name)
 					    g_get_user_data_dir (),
 					    "autocodebuild",
 					    priv->package_name);
-		g_print ("%s not found, perhaps you have to add 'Path' to %s\n",
-			 priv->path, defaults);
+		acb_project_print (project,
+				   "%s not found, perhaps you have to add 'Path' to %s\n",
+				   priv->path, defaults);
 		priv->disabled = TRUE;
 		return;
 	}
 
-	/* set build dir */
-	path_build = g_build_filename (priv->path, "build", NULL);
-	if (g_file_test (path_build, G_FILE_TEST_EXISTS)) {
-		priv->path_build = g_steal_pointer (&path_build);
-		priv->use_ninja = TRUE;
-	} else {
-		priv->path_build = g_strdup (priv->path);
-	}
-
-	/* load from config.h */
-	acb_project_get_from_config_h (project);
-
-	/* load from meson */
-	acb_project_get_from_meson (project);
-
 	/* generate fallbacks */
 	if (priv->tarball_name == NULL)
 		priv->tarball_name = g_strdup (priv->package_name);
 
-	if (acb_project_path_suffix_exists (project, ".git"))
-		priv->rcs = ACB_PROJECT_RCS_GIT;
-	else if (acb_project_path_suffix_exists (project, ".svn"))
-		priv->rcs = ACB_PROJECT_RCS_SVN;
-	else if (acb_project_path_suffix_exists (project, "CVS"))
-		priv->rcs = ACB_PROJECT_RCS_CVS;
-	else if (acb_project_path_suffix_exists (project, ".bzr"))
-		priv->rcs = ACB_PROJECT_RCS_BZR;
-
 	/* debugging */
 	g_debug ("path:         %s", priv->path);
 	g_debug ("package name: %s", priv->package_name);
 	g_debug ("tarball name: %s", priv->tarball_name);
-	g_debug ("version:      %s", priv->version);
 	g_debug ("release:      %i", priv->release);
 	g_debug ("disabled:     %i", priv->disabled);
 }
@@ -350,8 +852,16 @@ acb_project_kind_to_title (AcbProjectKind kind)
 		return "Cleaning";
 	if (kind == ACB_PROJECT_KIND_GARBAGE_COLLECTING)
 		return "Garbage collecting";
+	if (kind == ACB_PROJECT_KIND_COUNTING_OBJECTS)
+		return "Counting objects";
+	if (kind == ACB_PROJECT_KIND_REPACKING)
+		return "Repacking";
+	if (kind == ACB_PROJECT_KIND_WRITING_COMMIT_GRAPH)
+		return "Writing commit-graph";
 	if (kind == ACB_PROJECT_KIND_UPDATING)
 		return "Updating";
+	if (kind == ACB_PROJECT_KIND_CHECKING_UPDATES)
+		return "Checking for updates";
 	if (kind == ACB_PROJECT_KIND_GETTING_UPDATES)
 		return "Getting updates";
 	if (kind == ACB_PROJECT_KIND_SHOWING_UPDATES)
@@ -359,32 +869,58 @@ acb_project_kind_to_title (AcbProjectKind kind)
 	return NULL;
 }
 
+static const gchar *
+acb_project_kind_to_string (AcbProjectKind kind)
+{
+	if (kind == ACB_PROJECT_KIND_BUILDING_LOCALLY)
+		return "make";
+	if (kind == ACB_PROJECT_KIND_BUILDING_PACKAGE)
+		return "build";
+	if (kind == ACB_PROJECT_KIND_COPYING_TARBALL)
+		return "copy";
+	if (kind == ACB_PROJECT_KIND_CREATING_TARBALL)
+		return "dist";
+	if (kind == ACB_PROJECT_KIND_CLEANING)
+		return "clean";
+	if (kind == ACB_PROJECT_KIND_GARBAGE_COLLECTING)
+		return "gc";
+	if (kind == ACB_PROJECT_KIND_COUNTING_OBJECTS)
+		return "count-objects";
+	if (kind == ACB_PROJECT_KIND_REPACKING)
+		return "repack";
+	if (kind == ACB_PROJECT_KIND_WRITING_COMMIT_GRAPH)
+		return "commit-graph";
+	if (kind == ACB_PROJECT_KIND_UPDATING)
+		return "update";
+	if (kind == ACB_PROJECT_KIND_CHECKING_UPDATES)
+		return "ls-remote";
+	if (kind == ACB_PROJECT_KIND_GETTING_UPDATES)
+		return "fetch";
+	if (kind == ACB_PROJECT_KIND_SHOWING_UPDATES)
+		return "diffstat";
+	return NULL;
+}
+
 static gchar *
-acb_project_get_logfile (AcbProject *project, AcbProjectKind kind)
+acb_project_get_logfile (AcbProject *project, AcbProjectKind kind, const gchar *suffix)
 {
 	AcbProjectPrivate *priv = GET_PRIVATE (project);
 	g_autofree gchar *filename = NULL;
 
-	if (kind == ACB_PROJECT_KIND_BUILDING_LOCALLY)
-		filename = g_strdup_printf ("%s-%s", priv->package_name, "make.log");
-	else if (kind == ACB_PROJECT_KIND_BUILDING_PACKAGE)
-		filename = g_strdup_printf ("%s-%s", priv->package_name, "build.log");
-	else if (kind == ACB_PROJECT_KIND_COPYING_TARBALL)
-		filename = g_strdup_printf ("%s-%s", priv->package_name, "copy.log");
-	else if (kind == ACB_PROJECT_KIND_CREATING_TARBALL)
-		filename = g_strdup_printf ("%s-%s", priv->package_name, "dist.log");
-	else if (kind == ACB_PROJECT_KIND_CLEANING)
-		filename = g_strdup_printf ("%s-%s", priv->package_name, "clean.log");
-	else if (kind == ACB_PROJECT_KIND_UPDATING)
-		filename = g_strdup_printf ("%s-%s", priv->package_name, "update.log");
-	else if (kind == ACB_PROJECT_KIND_GETTING_UPDATES)
-		filename = g_strdup_printf ("%s-%s", priv->package_name, "fetch.log");
-	else if (kind == ACB_PROJECT_KIND_SHOWING_UPDATES)
-		filename = g_strdup_printf ("%s-%s", priv->package_name, "diffstat.log");
-	else
+	/* no log for these */
+	if (kind == ACB_PROJECT_KIND_GARBAGE_COLLECTING)
+		return NULL;
+	if (acb_project_kind_to_string (kind) == NULL)
 		return NULL;
 
-	return g_build_filename (g_get_user_data_dir (),
+	if (suffix != NULL) {
+		filename = g_strdup_printf ("%s-%s-%s.log", priv->package_name,
+					    acb_project_kind_to_string (kind), suffix);
+	} else {
+		filename = g_strdup_printf ("%s-%s.log", priv->package_name,
+					    acb_project_kind_to_string (kind));
+	}
+	return g_build_filename (g_get_user_data_dir (),
 				 "autocodebuild",
 				 filename,
 				 NULL);
@@ -403,84 +939,267 @@ acb_project_ensure_has_path (const gchar *path)
 }
 
 static gboolean
-acb_project_run (AcbProject *project,
-		 const gchar *command_line,
-		 AcbProjectKind kind,
-		 GError **error)
+acb_project_kind_uses_compiler (AcbProjectKind kind)
+{
+	return kind == ACB_PROJECT_KIND_BUILDING_LOCALLY ||
+	       kind == ACB_PROJECT_KIND_BUILDING_PACKAGE ||
+	       kind == ACB_PROJECT_KIND_CREATING_TARBALL;
+}
+
+/* the RCS commands work anywhere in the tree */
+static gboolean
+acb_project_kind_uses_build_dir (AcbProjectKind kind)
+{
+	return kind == ACB_PROJECT_KIND_BUILDING_LOCALLY ||
+	       kind == ACB_PROJECT_KIND_CREATING_TARBALL ||
+	       kind == ACB_PROJECT_KIND_CLEANING;
+}
+
+static gchar *
+acb_project_get_ccache_statslog (AcbProject *project, const gchar *suffix)
+{
+	AcbProjectPrivate *priv = GET_PRIVATE (project);
+	g_autofree gchar *filename = NULL;
+	if (suffix != NULL)
+		filename = g_strdup_printf ("%s-ccache-%s.log", priv->package_name, suffix);
+	else
+		filename = g_strdup_printf ("%s-ccache.log", priv->package_name);
+	return g_build_filename (g_get_user_data_dir (),
+				 "autocodebuild",
+				 filename,
+				 NULL);
+}
+
+static void
+acb_project_diffstat_line_cb (const gchar *line, gpointer user_data)
 {
+	AcbDiffstat *diffstat = ACB_DIFFSTAT (user_data);
+	acb_diffstat_add_line (diffstat, line);
+}
+
+static void
+acb_project_remote_head_cb (const gchar *line, gpointer user_data)
+{
+	AcbProject *project = ACB_PROJECT (user_data);
 	AcbProjectPrivate *priv = GET_PRIVATE (project);
+	g_auto(GStrv) split = NULL;
+
+	/* "<sha>\tHEAD" */
+	if (priv->remote_head_new != NULL)
+		return;
+	split = g_strsplit (line, "\t", 2);
+	if (split[0] == NULL || split[0][0] == '\0')
+		return;
+	priv->remote_head_new = g_strdup (split[0]);
+}
+
+static void
+acb_project_count_objects_cb (const gchar *line, gpointer user_data)
+{
+	AcbProject *project = ACB_PROJECT (user_data);
+	AcbProjectPrivate *priv = GET_PRIVATE (project);
+
+	if (g_str_has_prefix (line, "count: "))
+		priv->loose_objects = (guint) g_ascii_strtoull (line + 7, NULL, 10);
+	else if (g_str_has_prefix (line, "packs: "))
+		priv->packs = (guint) g_ascii_strtoull (line + 7, NULL, 10);
+}
+
+/* the suffix is used when the same kind is being run more than once at a time */
+static gboolean
+acb_project_run_full (AcbProject *project,
+		      const gchar *command_line,
+		      AcbProjectKind kind,
+		      const gchar *suffix,
+		      GError **error)
+{
+	AcbProjectPrivate *priv = GET_PRIVATE (project);
+	AcbStats *stats;
 	const gchar *title;
 	gboolean ret;
-	gint exit_status;
-	g_autofree gchar *diffstat = NULL;
 	g_autofree gchar *logfile = NULL;
-	g_autofree gchar *standard_error = NULL;
-	g_autofree gchar *standard_out = NULL;
+	g_autofree gchar *statslog = NULL;
+	g_autofree gchar *summary = NULL;
+	g_autofree gchar *tail = NULL;
 	g_auto(GStrv) argv = NULL;
+	g_auto(GStrv) envp = NULL;
+	g_autoptr(AcbDiffstat) diffstat = NULL;
+	g_autoptr(AcbSpawn) spawn = NULL;
+	g_autoptr(GError) error_local = NULL;
 
 	g_return_val_if_fail (ACB_IS_PROJECT (project), FALSE);
 
+	/* with a suffix the line is only printed when complete */
 	title = acb_project_kind_to_title (kind);
-	g_print ("%s %s...", title, priv->package_name);
-
-	argv = g_strsplit (command_line, " ", -1);
-	ret = g_spawn_sync (priv->path_build,
-			    argv,
-			    NULL,
-			    G_SPAWN_SEARCH_PATH,
-			    NULL,
-			    NULL,
-			    &standard_out,
-			    &standard_error,
-			    &exit_status,
-			    error);
-	if (!ret)
-		return FALSE;
+	if (suffix == NULL)
+		acb_project_print (project, "%s %s...", title, priv->package_name);
 
-	/* fail if we got the wrong retval */
-	if (exit_status != 0) {
-		ret = FALSE;
-		g_set_error (error, 1, 0, "%s: %s\n%s", "Failed to run", command_line, standard_error);
+	if (!g_shell_parse_argv (command_line, NULL, &argv, error))
 		return FALSE;
+
+	/* share the job slots with every other build */
+	envp = g_get_environ ();
+	if (priv->jobserver != NULL) {
+		envp = g_environ_setenv (envp, "MAKEFLAGS",
+					 acb_jobserver_get_makeflags (priv->jobserver),
+					 TRUE);
+	}
+
+	/* anything that compiles goes through the shared compiler cache */
+	if (priv->ccache != NULL && acb_project_kind_uses_compiler (kind)) {
+		statslog = acb_project_get_ccache_statslog (project, suffix);
+		g_unlink (statslog);
+		envp = acb_ccache_add_environ (priv->ccache, envp, statslog);
 	}
 
-	/* save to file */
-	logfile = acb_project_get_logfile (project, kind);
+	/* the output goes straight to the log as it arrives */
+	spawn = acb_spawn_new ();
+	if (acb_project_kind_uses_build_dir (kind))
+		acb_spawn_set_directory (spawn, acb_project_get_path_build (project));
+	else
+		acb_spawn_set_directory (spawn, priv->path);
+	acb_spawn_set_timeout (spawn,
+			       GPOINTER_TO_UINT (g_hash_table_lookup (priv->timeouts,
+								      acb_project_kind_to_string (kind))));
+	acb_spawn_set_environ (spawn, envp);
+	logfile = acb_project_get_logfile (project, kind, suffix);
 	if (logfile != NULL) {
 		acb_project_ensure_has_path (logfile);
-		if (!g_file_set_contents (logfile, standard_out, -1, error))
-			return FALSE;
+		acb_spawn_set_logfile (spawn, logfile);
+	}
+	if (kind == ACB_PROJECT_KIND_CHECKING_UPDATES) {
+		g_clear_pointer (&priv->remote_head_new, g_free);
+		acb_spawn_set_line_func (spawn, acb_project_remote_head_cb, project);
+	}
+	if (kind == ACB_PROJECT_KIND_COUNTING_OBJECTS) {
+		priv->loose_objects = 0;
+		priv->packs = 0;
+		acb_spawn_set_line_func (spawn, acb_project_count_objects_cb, project);
+	}
+	if (kind == ACB_PROJECT_KIND_SHOWING_UPDATES) {
+		diffstat = acb_diffstat_new ();
+		acb_spawn_set_line_func (spawn, acb_project_diffstat_line_cb, diffstat);
+	}
+	ret = acb_spawn_run (spawn, argv, &error_local);
+
+	/* save how long it took, even on failure */
+	stats = acb_stats_copy (acb_spawn_get_stats (spawn));
+	stats->project = g_strdup (priv->package_name);
+	stats->stage = g_strdup (acb_project_kind_to_string (kind));
+	g_mutex_lock (&priv->mutex);
+	g_ptr_array_add (priv->stats, stats);
+	g_mutex_unlock (&priv->mutex);
+	if (!ret) {
+		tail = acb_spawn_get_tail (spawn);
+		g_set_error (error, 1, 0, "%s: %s: %s\n%s", "Failed to run",
+			     command_line, error_local->message, tail);
+		return FALSE;
 	}
 
 	/* show any updates */
 	if (kind == ACB_PROJECT_KIND_SHOWING_UPDATES) {
-		if (standard_out[0] == '\0') {
-			g_print ("%s\n", "No updates");
+		if (acb_spawn_get_stdout_size (spawn) == 0) {
+			acb_project_print (project, "%s\n", "No updates");
+		} else if (acb_diffstat_get_files_changed (diffstat) == 0) {
+			acb_project_print (project, "Updated (but no diffstat):\n");
 		} else {
-			diffstat = g_strdup_printf ("/usr/bin/diffstat %s", logfile);
-			ret = g_spawn_command_line_sync (diffstat,
-							 &standard_out,
-							 NULL,
-							 NULL,
-							 error);
-			if (!ret)
-				return FALSE;
-			if (standard_out == NULL || standard_out[0] == '\0')
-				g_print ("Updated (but no diffstat):\n");
-			else
-				g_print ("Updated:\n%s\n", standard_out);
+			summary = acb_diffstat_to_string (diffstat);
+			acb_project_print (project, "Updated:\n%s\n", summary);
 		}
+	} else if (suffix != NULL) {
+		acb_project_print (project, "%s %s for %s...\t%s\n",
+				   title, priv->package_name, suffix, "Done");
 	} else {
-		g_print ("\t%s\n", "Done");
+		acb_project_print (project, "\t%s\n", "Done");
+	}
+
+	/* how useful was the cache */
+	if (statslog != NULL) {
+		guint hits;
+		guint misses;
+		if (acb_ccache_get_stats (statslog, &hits, &misses) &&
+		    hits + misses > 0) {
+			acb_project_print (project,
+					   "ccache: %u hits, %u misses (%u%%)\n",
+					   hits, misses, hits * 100 / (hits + misses));
+		}
 	}
 	return TRUE;
 }
 
+static gboolean
+acb_project_run (AcbProject *project,
+		 const gchar *command_line,
+		 AcbProjectKind kind,
+		 GError **error)
+{
+	return acb_project_run_full (project, command_line, kind, NULL, error);
+}
+
+/* only repack when git would think it was worth it */
+static gboolean
+acb_project_maintain_git (AcbProject *project, GError **error)
+{
+	AcbProjectPrivate *priv = GET_PRIVATE (project);
+	gint64 now = g_get_real_time () / G_USEC_PER_SEC;
+	guint git_version;
+
+	/* start counting from the first run, rather than doing every project at once */
+	if (priv->gc_aggressive_last == 0) {
+		priv->gc_aggressive_last = now;
+		if (!acb_project_write_conf (project, error))
+			return FALSE;
+	}
+
+	/* a full rewrite of the packs, but only rarely */
+	if (priv->gc_aggressive_days > 0 &&
+	    now - priv->gc_aggressive_last > (gint64) priv->gc_aggressive_days * 24 * 60 * 60) {
+		if (!acb_project_run (project, "git gc --aggressive",
+				      ACB_PROJECT_KIND_GARBAGE_COLLECTING, error))
+			return FALSE;
+		priv->gc_aggressive_last = now;
+		return acb_project_write_conf (project, error);
+	}
+
+	/* is it worth doing anything */
+	if (!acb_project_run (project, "git count-objects -v",
+			      ACB_PROJECT_KIND_COUNTING_OBJECTS, error))
+		return FALSE;
+	if (priv->loose_objects <= priv->gc_max_loose &&
+	    priv->packs <= priv->gc_max_packs) {
+		g_debug ("%s has %u loose objects in %u packs, not repacking",
+			 priv->package_name, priv->loose_objects, priv->packs);
+		return TRUE;
+	}
+
+	/* only merge the small packs, and update the commit-graph in layers,
+	 * which need git 2.32 and 2.24 respectively */
+	git_version = acb_spawn_get_version ("git");
+	if (git_version >= ACB_SPAWN_VERSION (2, 32)) {
+		if (!acb_project_run (project, "git repack -d -l --geometric=2",
+				      ACB_PROJECT_KIND_REPACKING, error))
+			return FALSE;
+	} else {
+		g_autofree gchar *cmdline = NULL;
+
+		/* let git decide, using the same thresholds */
+		cmdline = g_strdup_printf ("git -c gc.auto=%u -c gc.autoPackLimit=%u gc --auto",
+					   priv->gc_max_loose, priv->gc_max_packs);
+		if (!acb_project_run (project, cmdline,
+				      ACB_PROJECT_KIND_REPACKING, error))
+			return FALSE;
+	}
+	if (git_version < ACB_SPAWN_VERSION (2, 24))
+		return TRUE;
+	return acb_project_run (project, "git commit-graph write --reachable --split",
+				ACB_PROJECT_KIND_WRITING_COMMIT_GRAPH, error);
+}
+
 gboolean
 acb_project_clean (AcbProject *project, GError **error)
 {
-	gboolean ret;
 	AcbProjectPrivate *priv = GET_PRIVATE (project);
+	g_autofree gchar *cmdline = NULL;
 
 	g_return_val_if_fail (ACB_IS_PROJECT (project), FALSE);
 
@@ -489,21 +1208,97 @@ acb_project_clean (AcbProject *project, GError **error)
 		return TRUE;
 
 	/* clean the tree */
-	if (!acb_project_run (project, "make clean", ACB_PROJECT_KIND_CLEANING, error))
+	cmdline = acb_backend_get_clean_cmdline (acb_project_get_backend (project));
+	if (!acb_project_run (project, cmdline, ACB_PROJECT_KIND_CLEANING, error))
 		return FALSE;
 
 	/* clean repo? */
-	if (priv->rcs == ACB_PROJECT_RCS_GIT) {
-		ret = acb_project_run (project, "git gc --aggressive",
-				       ACB_PROJECT_KIND_GARBAGE_COLLECTING, error);
-		if (!ret)
-			return FALSE;
-	}
+	if (acb_project_get_rcs (project) == ACB_PROJECT_RCS_GIT)
+		return acb_project_maintain_git (project, error);
 
 	/* success */
 	return TRUE;
 }
 
+/* only trusted while the background fetches are keeping up */
+static gboolean
+acb_project_has_fresh_fetch (AcbProject *project)
+{
+	AcbProjectPrivate *priv = GET_PRIVATE (project);
+	gint64 now = g_get_real_time () / G_USEC_PER_SEC;
+
+	if (priv->fetch_head == NULL || priv->fetch_last == 0)
+		return FALSE;
+	return now - priv->fetch_last <= (gint64) priv->fetch_interval * 2;
+}
+
+/* the objects are already here, so nothing touches the network */
+static gboolean
+acb_project_update_local (AcbProject *project, GError **error)
+{
+	AcbProjectPrivate *priv = GET_PRIVATE (project);
+
+	priv->has_changes = TRUE;
+	if (priv->remote_head != NULL &&
+	    g_strcmp0 (priv->remote_head, priv->fetch_head) == 0) {
+		acb_project_print (project, "%s\n", "No updates");
+		priv->has_changes = g_strcmp0 (priv->built_head, priv->remote_head) != 0;
+		return TRUE;
+	}
+
+	/* whatever branch is checked out, against what it tracks */
+	if (!acb_project_run (project, "git diff HEAD..@{u}",
+			      ACB_PROJECT_KIND_SHOWING_UPDATES, error))
+		return FALSE;
+	if (!acb_project_run (project, "git rebase @{u}",
+			      ACB_PROJECT_KIND_UPDATING, error))
+		return FALSE;
+	g_free (priv->remote_head);
+	priv->remote_head = g_strdup (priv->fetch_head);
+	return acb_project_write_conf (project, error);
+}
+
+/* fetches upstream ahead of time so that the update does not have to */
+gboolean
+acb_project_prefetch (AcbProject *project, gboolean *fetched, GError **error)
+{
+	AcbProjectPrivate *priv = GET_PRIVATE (project);
+	gboolean changed;
+
+	g_return_val_if_fail (ACB_IS_PROJECT (project), FALSE);
+
+	if (fetched != NULL)
+		*fetched = FALSE;
+	if (priv->disabled)
+		return TRUE;
+	if (acb_project_get_rcs (project) != ACB_PROJECT_RCS_GIT)
+		return TRUE;
+
+	/* only fetch when the remote has moved */
+	if (!acb_project_run (project, "git ls-remote origin HEAD",
+			      ACB_PROJECT_KIND_CHECKING_UPDATES, error))
+		return FALSE;
+	changed = priv->remote_head_new != NULL &&
+		  g_strcmp0 (priv->fetch_head, priv->remote_head_new) != 0;
+	if (changed) {
+		if (!acb_project_run (project, "git fetch",
+				      ACB_PROJECT_KIND_GETTING_UPDATES, error))
+			return FALSE;
+		g_free (priv->fetch_head);
+		priv->fetch_head = g_strdup (priv->remote_head_new);
+	}
+
+	/* follow how often upstream actually commits */
+	if (changed)
+		priv->fetch_interval = MAX (priv->fetch_interval / 2, ACB_PROJECT_FETCH_INTERVAL_MIN);
+	else
+		priv->fetch_interval = MIN (priv->fetch_interval * 2, ACB_PROJECT_FETCH_INTERVAL_MAX);
+	priv->fetch_last = g_get_real_time () / G_USEC_PER_SEC;
+	if (fetched != NULL)
+		*fetched = changed;
+	return acb_project_write_conf (project, error);
+}
+
 gboolean
 acb_project_update (AcbProject *project, GError **error)
 {
@@ -516,64 +1311,66 @@ acb_project_update (AcbProject *project, GError **error)
 	if (priv->disabled)
 		return TRUE;
 
+	/* already fetched in the background */
+	if (acb_project_get_rcs (project) == ACB_PROJECT_RCS_GIT &&
+	    acb_project_has_fresh_fetch (project))
+		return acb_project_update_local (project, error);
+
+	/* only git can tell us cheaply if anything changed */
+	priv->has_changes = TRUE;
+	if (acb_project_get_rcs (project) == ACB_PROJECT_RCS_GIT) {
+		ret = acb_project_run (project, "git ls-remote origin HEAD",
+				       ACB_PROJECT_KIND_CHECKING_UPDATES, error);
+		if (!ret)
+			return FALSE;
+		if (priv->remote_head != NULL &&
+		    g_strcmp0 (priv->remote_head, priv->remote_head_new) == 0) {
+			acb_project_print (project, "%s\n", "No updates");
+			priv->has_changes = g_strcmp0 (priv->built_head, priv->remote_head) != 0;
+			return TRUE;
+		}
+	}
+
 	/* git does this in two stages */
-	if (priv->rcs == ACB_PROJECT_RCS_GIT) {
+	if (acb_project_get_rcs (project) == ACB_PROJECT_RCS_GIT) {
 		ret = acb_project_run (project, "git fetch",
 				       ACB_PROJECT_KIND_GETTING_UPDATES, error);
 		if (!ret)
 			return FALSE;
 
-		/* TODO: don't assume master */
-
 		/* show differences */
-		ret = acb_project_run (project, "git diff master..origin/master", ACB_PROJECT_KIND_SHOWING_UPDATES, error);
+		ret = acb_project_run (project, "git diff HEAD..@{u}", ACB_PROJECT_KIND_SHOWING_UPDATES, error);
 		if (!ret)
 			return FALSE;
 	}
 
-	/* apply the updates */
-	if (priv->rcs == ACB_PROJECT_RCS_GIT) {
-		return acb_project_run (project, "git pull --rebase", ACB_PROJECT_KIND_UPDATING, error);
+	/* apply the updates, a failed build is retried until the head is built */
+	if (acb_project_get_rcs (project) == ACB_PROJECT_RCS_GIT) {
+		ret = acb_project_run (project, "git pull --rebase",
+				       ACB_PROJECT_KIND_UPDATING, error);
+		if (!ret)
+			return FALSE;
+		if (priv->remote_head_new == NULL)
+			return TRUE;
+		g_free (priv->remote_head);
+		priv->remote_head = g_strdup (priv->remote_head_new);
+		g_free (priv->fetch_head);
+		priv->fetch_head = g_strdup (priv->remote_head_new);
+		return acb_project_write_conf (project, error);
 	}
-	if (priv->rcs == ACB_PROJECT_RCS_SVN) {
+	if (acb_project_get_rcs (project) == ACB_PROJECT_RCS_SVN) {
 		return acb_project_run (project, "svn up",
 					ACB_PROJECT_KIND_UPDATING, error);
 	}
-	if (priv->rcs == ACB_PROJECT_RCS_CVS) {
+	if (acb_project_get_rcs (project) == ACB_PROJECT_RCS_CVS) {
 		return acb_project_run (project, "cvs up",
 					ACB_PROJECT_KIND_UPDATING, error);
 	}
-	if (priv->rcs == ACB_PROJECT_RCS_BZR) {
+	if (acb_project_get_rcs (project) == ACB_PROJECT_RCS_BZR) {
 		return acb_project_run (project, "bzr up",
 					ACB_PROJECT_KIND_UPDATING, error);
 	}
-	g_print ("No detected RCS for %s!\n", priv->package_name);
-	return TRUE;
-}
-
-static gboolean
-acb_project_directory_remove_contents (const gchar *directory)
-{
-	const gchar *filename;
-	gint retval;
-	g_autoptr(GDir) dir = NULL;
-	g_autoptr(GError) error = NULL;
-
-	/* try to open */
-	dir = g_dir_open (directory, 0, &error);
-	if (dir == NULL) {
-		g_warning ("cannot open directory: %s", error->message);
-		return TRUE;
-	}
-
-	/* find each */
-	while ((filename = g_dir_read_name (dir))) {
-		g_autofree gchar *src = NULL;
-		src = g_build_filename (directory, filename, NULL);
-		retval = g_unlink (src);
-		if (retval != 0)
-			g_warning ("failed to delete %s", src);
-	}
+	acb_project_print (project, "No detected RCS for %s!\n", priv->package_name);
 	return TRUE;
 }
 
@@ -586,7 +1383,9 @@ acb_project_bump_release (AcbProject *project, GError **error)
 }
 
 static void
-acb_project_remove_all_files_with_prefix (const gchar *directory, const gchar *prefix)
+acb_project_remove_all_files_with_prefix (const gchar *directory,
+					  const gchar *prefix,
+					  GHashTable *keep)
 {
 	const gchar *filename;
 	gint retval;
@@ -605,6 +1404,8 @@ acb_project_remove_all_files_with_prefix (const gchar *directory, const gchar *p
 		g_autofree gchar *src = NULL;
 		if (!g_str_has_prefix (filename, prefix))
 			continue;
+		if (keep != NULL && g_hash_table_contains (keep, filename))
+			continue;
 		src = g_build_filename (directory, filename, NULL);
 		retval = g_unlink (src);
 		if (retval != 0)
@@ -612,24 +1413,12 @@ acb_project_remove_all_files_with_prefix (const gchar *directory, const gchar *p
 	}
 }
 
-static gboolean
-acb_project_copy_file (const gchar *src, const gchar *dest)
-{
-	gsize length;
-	g_autofree gchar *data = NULL;
-
-	/* just copy data */
-	if (!g_file_get_contents (src, &data, &length, NULL))
-		return FALSE;
-	if (!g_file_set_contents (dest, data, length, NULL))
-		return FALSE;
-	return TRUE;
-}
-
+/* each file replaces the old one atomically, so dest is never missing a package */
 static void
 acb_project_move_all_files_with_prefix (const gchar *directory,
 					const gchar *prefix,
-					const gchar *directory_dest)
+					const gchar *directory_dest,
+					GHashTable *moved)
 {
 	const gchar *filename;
 	g_autoptr(GDir) dir = NULL;
@@ -650,78 +1439,472 @@ acb_project_move_all_files_with_prefix (const gchar *directory,
 			continue;
 		src = g_build_filename (directory, filename, NULL);
 		dest = g_build_filename (directory_dest, filename, NULL);
-		acb_project_copy_file (src, dest);
+		if (!acb_file_copy (src, dest, ACB_FILE_COPY_FLAG_ALLOW_HARDLINK, &error)) {
+			g_warning ("%s", error->message);
+			g_clear_error (&error);
+			continue;
+		}
+		g_hash_table_add (moved, g_strdup (filename));
 	}
 }
 
 gboolean
 acb_project_make (AcbProject *project, GError **error)
 {
+	AcbProjectPrivate *priv = GET_PRIVATE (project);
+	guint slots = 0;
+	g_autofree gchar *cmdline = NULL;
+
 	g_return_val_if_fail (ACB_IS_PROJECT (project), FALSE);
-	return acb_project_run (project, "make",
+
+	if (priv->jobserver != NULL)
+		slots = acb_jobserver_get_slots (priv->jobserver);
+	cmdline = acb_backend_get_make_cmdline (acb_project_get_backend (project), slots);
+	return acb_project_run (project, cmdline,
 				ACB_PROJECT_KIND_BUILDING_LOCALLY, error);
 }
 
-gboolean
-acb_project_build (AcbProject *project, GError **error)
+static gchar *
+acb_project_get_tarball_basename (AcbProject *project)
 {
 	AcbProjectPrivate *priv = GET_PRIVATE (project);
-	GDate *date;
-	gboolean ret = TRUE;
-	gchar shortdate[128];
-	gchar longdate[128];
-	g_autofree gchar *alphatag = NULL;
-	g_autofree gchar *cmdline2 = NULL;
-	g_autofree gchar *cmdline = NULL;
-	g_autofree gchar *dest = NULL;
-	g_autofree gchar *rpmbuild_rpms = NULL;
-	g_autofree gchar *rpmbuild_sources = NULL;
-	g_autofree gchar *rpmbuild_specs = NULL;
-	g_autofree gchar *rpmbuild_srpms = NULL;
-	g_autofree gchar *spec = NULL;
-	g_autofree gchar *src = NULL;
+	if (g_strstr_len (priv->tarball_name, -1, ".") != NULL)
+		return g_strdup (priv->tarball_name);
+	return g_strdup_printf ("%s-%s", priv->tarball_name, acb_project_get_version (project));
+}
+
+/* tries each of the formats the backends can create */
+static gchar *
+acb_project_find_tarball_in_dir (const gchar *directory, const gchar *basename)
+{
+	const gchar *extensions[] = { "tar.xz", "tar.gz", "tar.bz2", "zip", NULL };
+	guint i;
+
+	for (i = 0; extensions[i] != NULL; i++) {
+		g_autofree gchar *filename = NULL;
+		g_autofree gchar *tarball = NULL;
+		filename = g_strdup_printf ("%s.%s", basename, extensions[i]);
+		tarball = g_build_filename (directory, filename, NULL);
+		if (g_file_test (tarball, G_FILE_TEST_IS_REGULAR))
+			return g_steal_pointer (&tarball);
+		g_debug ("tarball %s not found", tarball);
+	}
+	return NULL;
+}
+
+static gchar *
+acb_project_find_tarball (AcbProject *project, GError **error)
+{
+	AcbProjectPrivate *priv = GET_PRIVATE (project);
+	gchar *tarball;
+	g_autofree gchar *basename = NULL;
+	g_autofree gchar *dist_dir = NULL;
+
+	/* the backend knows where it puts it */
+	basename = acb_project_get_tarball_basename (project);
+	dist_dir = acb_backend_get_dist_dir (acb_project_get_backend (project), priv->path);
+	tarball = acb_project_find_tarball_in_dir (dist_dir, basename);
+	if (tarball != NULL)
+		return tarball;
+	g_set_error (error, 1, 0, "cannot find %s in %s", basename, dist_dir);
+	return NULL;
+}
+
+/* runs a quick command in the source tree, returning the first line */
+static gchar *
+acb_project_get_command_output (AcbProject *project, const gchar *command_line)
+{
+	AcbProjectPrivate *priv = GET_PRIVATE (project);
+	gint exit_status = 0;
 	g_autofree gchar *standard_out = NULL;
-	g_autofree gchar *tarball = NULL;
+	g_auto(GStrv) argv = NULL;
 
-	g_return_val_if_fail (ACB_IS_PROJECT (project), FALSE);
+	if (!g_shell_parse_argv (command_line, NULL, &argv, NULL))
+		return NULL;
+	if (!g_spawn_sync (priv->path, argv, NULL,
+			   G_SPAWN_SEARCH_PATH | G_SPAWN_STDERR_TO_DEV_NULL,
+			   NULL, NULL, &standard_out, NULL, &exit_status, NULL))
+		return NULL;
+	if (exit_status != 0 || standard_out == NULL)
+		return NULL;
+	g_strdelimit (standard_out, "\n", '\0');
+	return g_strdup (standard_out);
+}
 
-	/* disabled */
-	if (priv->disabled)
-		return TRUE;
+/* the same key means that 'make dist' would produce the same tarball */
+static gchar *
+acb_project_get_tarball_cache_dir (AcbProject *project)
+{
+	AcbProjectPrivate *priv = GET_PRIVATE (project);
+	g_autofree gchar *dirty = NULL;
+	g_autofree gchar *key = NULL;
+	g_autofree gchar *source_id = NULL;
+	g_autofree gchar *hash = NULL;
+
+	/* any local changes mean the tree has to be used */
+	if (acb_project_get_rcs (project) == ACB_PROJECT_RCS_GIT) {
+		source_id = acb_project_get_command_output (project, "git rev-parse HEAD^{tree}");
+		dirty = acb_project_get_command_output (project, "git status --porcelain --untracked-files=no");
+		if (dirty == NULL || dirty[0] != '\0')
+			return NULL;
+	} else if (acb_project_get_rcs (project) == ACB_PROJECT_RCS_SVN) {
+		source_id = acb_project_get_command_output (project, "svnversion");
+		if (source_id != NULL &&
+		    strspn (source_id, "0123456789") != strlen (source_id))
+			return NULL;
+	}
+	if (source_id == NULL || source_id[0] == '\0')
+		return NULL;
 
-	/* check we've got a spec file */
-	spec = g_strdup_printf ("%s/%s/%s.spec.in",
-				g_get_user_data_dir (),
-				"autocodebuild",
-				priv->package_name);
-	ret = g_file_test (spec, G_FILE_TEST_EXISTS);
-	if (!ret) {
-		g_set_error (error, 1, 0, "spec file was not found: %s", spec);
+	key = g_strdup_printf ("%s\n%s\n%s\n%s",
+			       priv->package_name, priv->tarball_name,
+			       acb_project_get_version (project), source_id);
+	hash = g_compute_checksum_for_string (G_CHECKSUM_SHA256, key, -1);
+	return g_build_filename (g_get_user_cache_dir (),
+				 "autocodebuild",
+				 "tarballs",
+				 hash,
+				 NULL);
+}
+
+/* only the expected name, so copies left by an interrupted run are ignored */
+static gchar *
+acb_project_get_cached_tarball (AcbProject *project, const gchar *cache_dir)
+{
+	g_autofree gchar *basename = acb_project_get_tarball_basename (project);
+	return acb_project_find_tarball_in_dir (cache_dir, basename);
+}
+
+/* only the newest tarball of each project is kept */
+static gboolean
+acb_project_add_cached_tarball (AcbProject *project,
+				const gchar *cache_dir,
+				const gchar *tarball,
+				GError **error)
+{
+	AcbProjectPrivate *priv = GET_PRIVATE (project);
+	g_autofree gchar *basename = NULL;
+	g_autofree gchar *dest = NULL;
+	g_autofree gchar *key = NULL;
+
+	if (g_mkdir_with_parents (cache_dir, 0755) != 0) {
+		g_set_error (error, 1, 0, "failed to create %s", cache_dir);
 		return FALSE;
 	}
+	basename = g_path_get_basename (tarball);
+	dest = g_build_filename (cache_dir, basename, NULL);
+	if (!acb_file_copy (tarball, dest, ACB_FILE_COPY_FLAG_NONE, error))
+		return FALSE;
 
-	/* then make tarball */
-	if (priv->use_ninja) {
-		ret = acb_project_run (project, "ninja-build dist",
-				       ACB_PROJECT_KIND_CREATING_TARBALL, error);
-		if (!ret)
+	/* the old key can never match again once the source has moved on */
+	key = g_path_get_basename (cache_dir);
+	if (priv->tarball_cache != NULL &&
+	    g_strcmp0 (priv->tarball_cache, key) != 0) {
+		g_autofree gchar *parent = g_path_get_dirname (cache_dir);
+		g_autofree gchar *old = g_build_filename (parent, priv->tarball_cache, NULL);
+		g_autoptr(GError) error_local = NULL;
+		if (!acb_file_remove_tree (old, &error_local))
+			g_warning ("failed to remove %s: %s", old, error_local->message);
+	}
+	g_free (priv->tarball_cache);
+	priv->tarball_cache = g_steal_pointer (&key);
+	return acb_project_write_conf (project, error);
+}
+
+typedef struct {
+	AcbProject		*project;
+	AcbTarget		*target;
+	gchar			*topdir;
+	gchar			*workdir;
+	gchar			*spec;
+	gboolean		 ret;
+	GError			*error;
+} AcbProjectTargetHelper;
+
+static void
+acb_project_target_helper_free (AcbProjectTargetHelper *helper)
+{
+	g_free (helper->topdir);
+	g_free (helper->workdir);
+	g_free (helper->spec);
+	if (helper->error != NULL)
+		g_error_free (helper->error);
+	g_free (helper);
+}
+
+/* the RPMs for each target are kept apart so they can be built at once */
+static gchar *
+acb_project_get_target_dir (const gchar *topdir, const gchar *kind, AcbTarget *target)
+{
+	return g_build_filename (topdir, kind, target->id, NULL);
+}
+
+/* workdir is where the sources are unpacked and installed, which may be scratch */
+static gchar *
+acb_project_get_rpmbuild_cmdline (AcbProject *project,
+				  AcbTarget *target,
+				  const gchar *topdir,
+				  const gchar *workdir,
+				  const gchar *spec)
+{
+	AcbProjectPrivate *priv = GET_PRIVATE (project);
+	GString *rpmbuild;
+	guint i;
+	g_autofree gchar *builddir = NULL;
+	g_autofree gchar *buildrootdir = NULL;
+	g_autofree gchar *rpmdir = NULL;
+	g_autofree gchar *srcrpmdir = NULL;
+
+	builddir = acb_project_get_target_dir (workdir, "BUILD", target);
+	buildrootdir = acb_project_get_target_dir (workdir, "BUILDROOT", target);
+	rpmdir = acb_project_get_target_dir (topdir, "RPMS", target);
+	srcrpmdir = acb_project_get_target_dir (topdir, "SRPMS", target);
+	rpmbuild = g_string_new ("rpmbuild -ba");
+	g_string_append_printf (rpmbuild, " --target %s", target->arch);
+	g_string_append_printf (rpmbuild, " --define '_topdir %s'", topdir);
+	g_string_append_printf (rpmbuild, " --define '_builddir %s'", builddir);
+	g_string_append_printf (rpmbuild, " --define '_buildrootdir %s'", buildrootdir);
+	g_string_append_printf (rpmbuild, " --define '_rpmdir %s'", rpmdir);
+	g_string_append_printf (rpmbuild, " --define '_srcrpmdir %s'", srcrpmdir);
+	g_string_append (rpmbuild, " --define '_build_name_fmt %{NAME}-%{VERSION}-%{RELEASE}.%{ARCH}.rpm'");
+	for (i = 0; target->macros != NULL && target->macros[i] != NULL; i++)
+		g_string_append_printf (rpmbuild, " --define '%s'", target->macros[i]);
+
+	/* use the jobserver rather than a fixed -j, or else share the CPUs
+	 * between the targets being built at the same time */
+	if (priv->jobserver != NULL) {
+		g_string_append (rpmbuild, " --define '_smp_mflags %{nil}'");
+	} else if (priv->targets->len > 1) {
+		guint jobs = MAX (g_get_num_processors () / priv->targets->len, 1);
+		g_string_append_printf (rpmbuild, " --define '_smp_mflags -j%u'", jobs);
+	}
+	if (priv->ccache != NULL)
+		g_string_append (rpmbuild, " --define '__cc ccache gcc' --define '__cxx ccache g++'");
+	g_string_append_printf (rpmbuild, " %s", spec);
+	return g_string_free (rpmbuild, FALSE);
+}
+
+static void
+acb_project_build_target_cb (gpointer data, gpointer user_data)
+{
+	AcbProjectTargetHelper *helper = (AcbProjectTargetHelper *) data;
+	AcbProjectPrivate *priv = GET_PRIVATE (helper->project);
+	gboolean has_token = FALSE;
+	g_autofree gchar *cmdline = NULL;
+
+	/* the scheduler only holds one token for the whole project */
+	if (priv->jobserver != NULL) {
+		has_token = acb_jobserver_acquire (priv->jobserver, &helper->error);
+		if (!has_token)
+			return;
+	}
+	cmdline = acb_project_get_rpmbuild_cmdline (helper->project,
+						    helper->target,
+						    helper->topdir,
+						    helper->workdir,
+						    helper->spec);
+	helper->ret = acb_project_run_full (helper->project, cmdline,
+					    ACB_PROJECT_KIND_BUILDING_PACKAGE,
+					    helper->target->id,
+					    &helper->error);
+	if (has_token)
+		acb_jobserver_release (priv->jobserver);
+}
+
+/* builds the targets side by side from the same spec and tarball */
+static gboolean
+acb_project_build_targets (AcbProject *project,
+			   const gchar *topdir,
+			   const gchar *workdir,
+			   const gchar *spec,
+			   GError **error)
+{
+	AcbProjectPrivate *priv = GET_PRIVATE (project);
+	GThreadPool *pool = NULL;
+	guint i;
+	guint slots;
+	g_autoptr(GPtrArray) helpers = NULL;
+	g_autofree gchar *cmdline = NULL;
+
+	/* the first target runs in this thread with the token we hold, and
+	 * no more targets run at once than there are slots to share */
+	if (priv->jobserver != NULL)
+		slots = acb_jobserver_get_slots (priv->jobserver);
+	else
+		slots = g_get_num_processors ();
+	if (priv->targets->len > 1) {
+		pool = g_thread_pool_new (acb_project_build_target_cb, NULL,
+					  (gint) MAX (MIN (priv->targets->len, slots), 2) - 1,
+					  FALSE, error);
+		if (pool == NULL)
 			return FALSE;
-	} else {
-		ret = acb_project_run (project, "make dist",
-				       ACB_PROJECT_KIND_CREATING_TARBALL, error);
-		if (!ret)
+	}
+	helpers = g_ptr_array_new_with_free_func ((GDestroyNotify) acb_project_target_helper_free);
+	for (i = 1; i < priv->targets->len; i++) {
+		AcbProjectTargetHelper *helper = g_new0 (AcbProjectTargetHelper, 1);
+		helper->project = project;
+		helper->target = g_ptr_array_index (priv->targets, i);
+		helper->topdir = g_strdup (topdir);
+		helper->workdir = g_strdup (workdir);
+		helper->spec = g_strdup (spec);
+		g_ptr_array_add (helpers, helper);
+		g_thread_pool_push (pool, helper, NULL);
+	}
+	cmdline = acb_project_get_rpmbuild_cmdline (project,
+						    g_ptr_array_index (priv->targets, 0),
+						    topdir, workdir, spec);
+	if (priv->targets->len > 1) {
+		AcbTarget *target = g_ptr_array_index (priv->targets, 0);
+		if (!acb_project_run_full (project, cmdline,
+					   ACB_PROJECT_KIND_BUILDING_PACKAGE,
+					   target->id, error)) {
+			g_prefix_error (error, "%s: ", target->id);
+			/* the targets still queued are not started */
+			g_thread_pool_free (pool, TRUE, TRUE);
 			return FALSE;
+		}
+	} else if (!acb_project_run (project, cmdline,
+				     ACB_PROJECT_KIND_BUILDING_PACKAGE, error)) {
+		return FALSE;
 	}
 
-	/* clean previous build files */
-	g_print ("%s...", "Cleaning previous package files");
-	rpmbuild_rpms = g_build_filename (priv->rpmbuild_path, "RPMS", NULL);
-	rpmbuild_srpms = g_build_filename (priv->rpmbuild_path, "SRPMS", NULL);
-	rpmbuild_sources = g_build_filename (priv->rpmbuild_path, "SOURCES", NULL);
-	rpmbuild_specs = g_build_filename (priv->rpmbuild_path, "SPECS", NULL);
-	acb_project_directory_remove_contents (rpmbuild_rpms);
-	acb_project_directory_remove_contents (rpmbuild_srpms);
-	g_print ("\t%s\n", "Done");
+	/* all of them have to work */
+	if (pool != NULL)
+		g_thread_pool_free (pool, FALSE, TRUE);
+	for (i = 0; i < helpers->len; i++) {
+		AcbProjectTargetHelper *helper = g_ptr_array_index (helpers, i);
+		if (helper->ret)
+			continue;
+		g_propagate_prefixed_error (error, g_steal_pointer (&helper->error),
+					    "%s: ", helper->target->id);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/* nothing outside the topdir is touched until the build has succeeded */
+static gchar *
+acb_project_create_topdir (AcbProject *project, GError **error)
+{
+	AcbProjectPrivate *priv = GET_PRIVATE (project);
+	const gchar *subdirs[] = { "SOURCES", "SPECS", NULL };
+	guint i;
+	g_autofree gchar *tmpdir = NULL;
+	g_autofree gchar *topdir = NULL;
+
+	tmpdir = g_build_filename (priv->rpmbuild_path, "tmp", NULL);
+	if (g_mkdir_with_parents (tmpdir, 0755) != 0) {
+		g_set_error (error, 1, 0, "failed to create %s: %s",
+			     tmpdir, g_strerror (errno));
+		return NULL;
+	}
+	topdir = g_strdup_printf ("%s/%s-XXXXXX", tmpdir, priv->package_name);
+	if (g_mkdtemp (topdir) == NULL) {
+		g_set_error (error, 1, 0, "failed to create %s: %s",
+			     topdir, g_strerror (errno));
+		return NULL;
+	}
+	if (!acb_file_set_owner (topdir, error)) {
+		acb_file_remove_tree (topdir, NULL);
+		return NULL;
+	}
+	for (i = 0; subdirs[i] != NULL; i++) {
+		g_autofree gchar *subdir = g_build_filename (topdir, subdirs[i], NULL);
+		if (g_mkdir (subdir, 0755) != 0) {
+			g_set_error (error, 1, 0, "failed to create %s: %s",
+				     subdir, g_strerror (errno));
+			acb_file_remove_tree (topdir, NULL);
+			return NULL;
+		}
+	}
+	return g_steal_pointer (&topdir);
+}
+
+/* returns NULL if the build should just use the topdir instead */
+static gchar *
+acb_project_create_scratch (AcbProject *project)
+{
+	AcbProjectPrivate *priv = GET_PRIVATE (project);
+	struct statvfs buf;
+	guint64 available;
+	g_autofree gchar *scratch = NULL;
+
+	if (priv->scratch_dir == NULL)
+		return NULL;
+	if (g_mkdir_with_parents (priv->scratch_dir, 0755) != 0 ||
+	    statvfs (priv->scratch_dir, &buf) != 0) {
+		acb_project_print (project, "Cannot use scratch %s: %s\n",
+				   priv->scratch_dir, g_strerror (errno));
+		return NULL;
+	}
+
+	/* running out of space half way through is much slower */
+	available = (guint64) buf.f_bavail * buf.f_frsize;
+	if (available < priv->scratch_min_size) {
+		acb_project_print (project,
+				   "Only %" G_GUINT64_FORMAT "MB free in %s, not using scratch\n",
+				   available / (1024 * 1024), priv->scratch_dir);
+		return NULL;
+	}
+	scratch = g_strdup_printf ("%s/%s-XXXXXX", priv->scratch_dir, priv->package_name);
+	if (g_mkdtemp (scratch) == NULL) {
+		acb_project_print (project, "Cannot use scratch %s: %s\n",
+				   priv->scratch_dir, g_strerror (errno));
+		return NULL;
+	}
+	return g_steal_pointer (&scratch);
+}
+
+/* patches and extra sources are shared by all builds and never modified */
+static gboolean
+acb_project_link_sources (AcbProject *project, const gchar *topdir, GError **error)
+{
+	AcbProjectPrivate *priv = GET_PRIVATE (project);
+	const gchar *filename;
+	g_autofree gchar *sources = NULL;
+	g_autoptr(GDir) dir = NULL;
+
+	sources = g_build_filename (priv->rpmbuild_path, "SOURCES", NULL);
+	if (!g_file_test (sources, G_FILE_TEST_IS_DIR))
+		return TRUE;
+	dir = g_dir_open (sources, 0, error);
+	if (dir == NULL)
+		return FALSE;
+	while ((filename = g_dir_read_name (dir))) {
+		g_autofree gchar *src = g_build_filename (sources, filename, NULL);
+		g_autofree gchar *dest = g_build_filename (topdir, "SOURCES", filename, NULL);
+		if (symlink (src, dest) != 0) {
+			g_set_error (error, 1, 0, "failed to link %s: %s",
+				     src, g_strerror (errno));
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+static gboolean
+acb_project_build_package (AcbProject *project,
+			   const gchar *topdir,
+			   const gchar *workdir,
+			   const gchar *spec,
+			   const gchar *tarball,
+			   GError **error)
+{
+	AcbProjectPrivate *priv = GET_PRIVATE (project);
+	GDate *date;
+	GHashTableIter iter;
+	gchar shortdate[128];
+	gchar longdate[128];
+	gpointer key;
+	gpointer value;
+	guint i;
+	g_autofree gchar *alphatag = NULL;
+	g_autofree gchar *basename = NULL;
+	g_autofree gchar *dest = NULL;
+	g_autofree gchar *release = NULL;
+	g_autofree gchar *spec_data = NULL;
+	g_autofree gchar *spec_name = NULL;
+	g_autofree gchar *tarball_dest = NULL;
 
 	/* get the date formats */
 	date = g_date_new ();
@@ -731,89 +1914,155 @@ acb_project_build (AcbProject *project, GError **error)
 	g_date_free (date);
 
 	/* get the alpha tag */
-	if (priv->rcs == ACB_PROJECT_RCS_GIT)
+	if (acb_project_get_rcs (project) == ACB_PROJECT_RCS_GIT)
 		alphatag = g_strdup_printf (".%sgit", shortdate); /* .20070409svn */
-	else if (priv->rcs == ACB_PROJECT_RCS_SVN)
+	else if (acb_project_get_rcs (project) == ACB_PROJECT_RCS_SVN)
 		alphatag = g_strdup_printf (".%ssvn", shortdate);
-	else if (priv->rcs == ACB_PROJECT_RCS_CVS)
+	else if (acb_project_get_rcs (project) == ACB_PROJECT_RCS_CVS)
 		alphatag = g_strdup_printf (".%scvs", shortdate);
 
 	/* do the replacement */
-	cmdline = g_strdup_printf ("sed \"s/#VERSION#/%s/g;s/#BUILD#/%i/g;s/#ALPHATAG#/%s/g;s/#LONGDATE#/%s/g\" %s",
-				   priv->version, priv->release, alphatag, longdate, spec);
-	ret = g_spawn_command_line_sync (cmdline, &standard_out, NULL, NULL, error);
-	if (!ret)
+	if (!acb_template_load_file (priv->spec_template, spec, error))
 		return FALSE;
+	g_hash_table_iter_init (&iter, priv->variables);
+	while (g_hash_table_iter_next (&iter, &key, &value))
+		acb_template_set_value (priv->spec_template, key, value);
+	release = g_strdup_printf ("%i", priv->release);
+	acb_template_set_value (priv->spec_template, "VERSION", acb_project_get_version (project));
+	acb_template_set_value (priv->spec_template, "BUILD", release);
+	acb_template_set_value (priv->spec_template, "ALPHATAG", alphatag);
+	acb_template_set_value (priv->spec_template, "LONGDATE", longdate);
+	spec_data = acb_template_render (priv->spec_template);
 
 	/* save to the new file */
-	dest = g_strdup_printf ("%s/%s.spec", rpmbuild_specs, priv->package_name);
-	if (!g_file_set_contents (dest, standard_out, -1, error))
+	spec_name = g_strdup_printf ("%s.spec", priv->package_name);
+	dest = g_build_filename (topdir, "SPECS", spec_name, NULL);
+	if (!g_file_set_contents (dest, spec_data, -1, error))
 		return FALSE;
 
-	/* get the tarball */
-	if (g_strstr_len (priv->tarball_name, -1, ".") != NULL)
-		tarball = g_strdup_printf ("%s/%s.tar.bz2", priv->path, priv->tarball_name);
-	else
-		tarball = g_strdup_printf ("%s/%s-%s.tar.bz2", priv->path, priv->tarball_name, priv->version);
-	if (!g_file_test (tarball, G_FILE_TEST_EXISTS)) {
-		g_debug ("bzipped tarball %s not found", tarball);
-		tarball = g_strdup_printf ("%s/%s-%s.tar.gz", priv->path, priv->tarball_name, priv->version);
-	}
-	if (!g_file_test (tarball, G_FILE_TEST_EXISTS)) {
-		g_debug ("gzipped tarball %s not found", tarball);
-		tarball = g_strdup_printf ("%s/%s-%s.tar.xz", priv->path, priv->tarball_name, priv->version);
-	}
-	if (!g_file_test (tarball, G_FILE_TEST_EXISTS)) {
-		g_debug ("gzipped meson tarball %s not found", tarball);
-		tarball = g_strdup_printf ("%s/build/meson-dist/%s-%s.tar.xz", priv->path, priv->tarball_name, priv->version);
-	}
-	if (!g_file_test (tarball, G_FILE_TEST_EXISTS)) {
-		g_debug ("xz tarball %s not found", tarball);
-		tarball = g_strdup_printf ("%s/%s-%s.zip", priv->path, priv->tarball_name, priv->version);
-	}
-	if (!g_file_test (tarball, G_FILE_TEST_EXISTS)) {
-		g_debug ("zipped tarball %s not found", tarball);
-		g_set_error (error, 1, 0, "cannot find source in %s", priv->path);
-		return FALSE;
-	}
-
 	/* copy tarball .tar.* build root */
-	cmdline2 = g_strdup_printf ("cp %s %s", tarball, rpmbuild_sources);
-	ret = acb_project_run (project, cmdline2, ACB_PROJECT_KIND_COPYING_TARBALL, error);
-	if (!ret)
+	acb_project_print (project, "%s...",
+			   acb_project_kind_to_title (ACB_PROJECT_KIND_COPYING_TARBALL));
+	if (!acb_project_link_sources (project, topdir, error))
+		return FALSE;
+	basename = g_path_get_basename (tarball);
+	tarball_dest = g_build_filename (topdir, "SOURCES", basename, NULL);
+	if (!acb_file_copy (tarball, tarball_dest, ACB_FILE_COPY_FLAG_ALLOW_HARDLINK, error))
 		return FALSE;
+	acb_project_print (project, "\t%s\n", "Done");
 
-	/* build the rpm */
-	cmdline2 = g_strdup_printf ("rpmbuild -ba %s", dest);
-	ret = acb_project_run (project, cmdline2, ACB_PROJECT_KIND_BUILDING_PACKAGE, error);
-	if (!ret)
+	/* build the rpms */
+	if (!acb_project_build_targets (project, topdir, workdir, dest, error))
 		return FALSE;
 
 	/* increment the release */
-	g_print ("%s...", "Incrementing release");
+	acb_project_print (project, "%s...", "Incrementing release");
 	if (!acb_project_bump_release (project, error))
 		return FALSE;
-	g_print ("\t%s\n", "Done");
-
-	/* delete old versions in repo directory */
-	g_print ("%s...", "Deleting old versions");
-	src = g_build_filename (priv->rpmbuild_path, "REPOS/fedora/28/x86_64", NULL);
-	acb_project_remove_all_files_with_prefix (src, priv->package_name);
-	src = g_build_filename (priv->rpmbuild_path, "REPOS/fedora/28/SRPMS", NULL);
-	acb_project_remove_all_files_with_prefix (src, priv->package_name);
-	g_print ("\t%s\n", "Done");
-
-	/* copy into repo directory */
-	g_print ("%s...", "Copying new version");
-	dest = g_build_filename (priv->rpmbuild_path, "REPOS/fedora/28/x86_64", NULL);
-	acb_project_move_all_files_with_prefix (rpmbuild_rpms, priv->package_name, dest);
-	dest = g_build_filename (priv->rpmbuild_path, "REPOS/fedora/28/SRPMS", NULL);
-	acb_project_move_all_files_with_prefix (rpmbuild_srpms, priv->package_name, dest);
-	g_print ("\t%s\n", "Done");
-
-	/* remove generated file */
-	g_unlink (dest);
-	return TRUE;
+	acb_project_print (project, "\t%s\n", "Done");
+
+	/* replace the old versions in each repo directory */
+	acb_project_print (project, "%s...", "Copying new version");
+	for (i = 0; i < priv->targets->len; i++) {
+		AcbTarget *target = g_ptr_array_index (priv->targets, i);
+		g_autofree gchar *repo = NULL;
+		g_autofree gchar *repo_srpms = NULL;
+		g_autofree gchar *rpmbuild_rpms = NULL;
+		g_autofree gchar *rpmbuild_srpms = NULL;
+		g_autoptr(GHashTable) moved = NULL;
+		g_autoptr(GHashTable) moved_srpms = NULL;
+
+		repo = acb_target_get_repo_dir (target, priv->rpmbuild_path);
+		repo_srpms = acb_target_get_srpm_repo_dir (target, priv->rpmbuild_path);
+		g_mkdir_with_parents (repo, 0755);
+		g_mkdir_with_parents (repo_srpms, 0755);
+		moved = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+		moved_srpms = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+		rpmbuild_rpms = acb_project_get_target_dir (topdir, "RPMS", target);
+		rpmbuild_srpms = acb_project_get_target_dir (topdir, "SRPMS", target);
+		acb_project_move_all_files_with_prefix (rpmbuild_rpms, priv->package_name,
+							repo, moved);
+		acb_project_move_all_files_with_prefix (rpmbuild_srpms, priv->package_name,
+							repo_srpms, moved_srpms);
+		acb_project_remove_all_files_with_prefix (repo, priv->package_name, moved);
+		acb_project_remove_all_files_with_prefix (repo_srpms, priv->package_name,
+							  moved_srpms);
+	}
+	acb_project_print (project, "\t%s\n", "Done");
+
+	/* the release is in the published packages, so it cannot wait for
+	 * the end of the run to be saved */
+	return acb_manifest_save_project (priv->manifest, priv->package_name, error);
+}
+
+gboolean
+acb_project_build (AcbProject *project, GError **error)
+{
+	AcbProjectPrivate *priv = GET_PRIVATE (project);
+	gboolean ret = TRUE;
+	g_autofree gchar *cache_dir = NULL;
+	g_autofree gchar *spec = NULL;
+	g_autofree gchar *tarball = NULL;
+	g_autofree gchar *scratch = NULL;
+	g_autofree gchar *topdir = NULL;
+	g_autoptr(GError) error_local = NULL;
+	g_autoptr(GError) error_scratch = NULL;
+	g_autoptr(GError) error_topdir = NULL;
+
+	g_return_val_if_fail (ACB_IS_PROJECT (project), FALSE);
+
+	/* disabled */
+	if (priv->disabled)
+		return TRUE;
+
+	/* check we've got a spec file */
+	spec = g_strdup_printf ("%s/%s/%s.spec.in",
+				g_get_user_data_dir (),
+				"autocodebuild",
+				priv->package_name);
+	ret = g_file_test (spec, G_FILE_TEST_EXISTS);
+	if (!ret) {
+		g_set_error (error, 1, 0, "spec file was not found: %s", spec);
+		return FALSE;
+	}
+
+	/* reuse the tarball if the source has not changed */
+	cache_dir = acb_project_get_tarball_cache_dir (project);
+	if (cache_dir != NULL)
+		tarball = acb_project_get_cached_tarball (project, cache_dir);
+	if (tarball != NULL) {
+		acb_project_print (project, "Using cached tarball %s\n", tarball);
+	} else {
+		g_autofree gchar *basename = acb_project_get_tarball_basename (project);
+		g_autofree gchar *cmdline = NULL;
+		cmdline = acb_backend_get_dist_cmdline (acb_project_get_backend (project), basename,
+							priv->dist_tests);
+		ret = acb_project_run (project, cmdline,
+				       ACB_PROJECT_KIND_CREATING_TARBALL, error);
+		if (!ret)
+			return FALSE;
+		tarball = acb_project_find_tarball (project, error);
+		if (tarball == NULL)
+			return FALSE;
+		if (cache_dir != NULL &&
+		    !acb_project_add_cached_tarball (project, cache_dir, tarball, &error_local)) {
+			g_warning ("failed to cache %s: %s", tarball, error_local->message);
+		}
+	}
+
+	/* each package gets a private rpmbuild tree, so builds can run at once */
+	topdir = acb_project_create_topdir (project, error);
+	if (topdir == NULL)
+		return FALSE;
+	scratch = acb_project_create_scratch (project);
+	ret = acb_project_build_package (project, topdir,
+					 scratch != NULL ? scratch : topdir,
+					 spec, tarball, error);
+	if (scratch != NULL && !acb_file_remove_tree (scratch, &error_scratch))
+		g_warning ("failed to clean up: %s", error_scratch->message);
+	if (!acb_file_remove_tree (topdir, &error_topdir))
+		g_warning ("failed to clean up: %s", error_topdir->message);
+	return ret;
 }
 
 static void
@@ -831,9 +2080,32 @@ acb_project_finalize (GObject *object)
 	g_free (priv->path_build);
 	g_free (priv->default_code_path);
 	g_free (priv->rpmbuild_path);
+	g_free (priv->scratch_dir);
 	g_free (priv->version);
 	g_free (priv->tarball_name);
 	g_free (priv->package_name);
+	g_strfreev (priv->depends);
+	g_free (priv->remote_head);
+	g_free (priv->remote_head_new);
+	g_free (priv->built_head);
+	g_free (priv->fetch_head);
+	g_free (priv->tarball_cache);
+	if (priv->jobserver != NULL)
+		g_object_unref (priv->jobserver);
+	if (priv->ccache != NULL)
+		g_object_unref (priv->ccache);
+	if (priv->manifest != NULL)
+		g_object_unref (priv->manifest);
+	if (priv->probe != NULL)
+		g_object_unref (priv->probe);
+	g_ptr_array_unref (priv->stats);
+	g_hash_table_unref (priv->timeouts);
+	g_hash_table_unref (priv->variables);
+	g_object_unref (priv->spec_template);
+	g_ptr_array_unref (priv->targets);
+	g_mutex_clear (&priv->mutex);
+	if (priv->output != NULL)
+		g_string_free (priv->output, TRUE);
 
 	G_OBJECT_CLASS (acb_project_parent_class)->finalize (object);
 }
@@ -850,6 +2122,24 @@ acb_project_init (AcbProject *project)
 {
 	AcbProjectPrivate *priv = GET_PRIVATE (project);
 	priv->rcs = ACB_PROJECT_RCS_UNKNOWN;
+	priv->has_changes = TRUE;
+	priv->gc_max_loose = ACB_PROJECT_GC_MAX_LOOSE;
+	priv->gc_max_packs = ACB_PROJECT_GC_MAX_PACKS;
+	priv->gc_aggressive_days = ACB_PROJECT_GC_AGGRESSIVE_DAYS;
+	priv->fetch_interval = ACB_PROJECT_FETCH_INTERVAL;
+	priv->scratch_min_size = acb_project_parse_size (ACB_PROJECT_SCRATCH_MIN_SIZE);
+	priv->stats = g_ptr_array_new_with_free_func ((GDestroyNotify) acb_stats_free);
+	priv->timeouts = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	priv->variables = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+	priv->spec_template = acb_template_new ();
+	priv->targets = acb_target_load_all (NULL);
+	g_mutex_init (&priv->mutex);
+
+	/* network operations are the most likely to hang forever */
+	g_hash_table_insert (priv->timeouts, g_strdup ("fetch"),
+			     GUINT_TO_POINTER (ACB_PROJECT_TIMEOUT_NETWORK));
+	g_hash_table_insert (priv->timeouts, g_strdup ("update"),
+			     GUINT_TO_POINTER (ACB_PROJECT_TIMEOUT_NETWORK));
 }
 
 AcbProject *
@@ -24,6 +24,12 @@
 
 #include <glib-object.h>
 
+#include "acb-ccache.h"
+#include "acb-jobserver.h"
+#include "acb-manifest.h"
+#include "acb-probe.h"
+#include "acb-stats.h"
+
 G_BEGIN_DECLS
 
 #define ACB_TYPE_PROJECT (acb_project_get_type ())
@@ -39,12 +45,43 @@ void		 acb_project_set_default_code_path	(AcbProject		*project,
 							 const gchar		*path);
 void		 acb_project_set_rpmbuild_path		(AcbProject		*project,
 							 const gchar		*path);
+void		 acb_project_set_jobserver		(AcbProject		*project,
+							 AcbJobserver		*jobserver);
+void		 acb_project_set_targets		(AcbProject		*project,
+							 GPtrArray		*targets);
+void		 acb_project_set_ccache			(AcbProject		*project,
+							 AcbCcache		*ccache);
+void		 acb_project_set_manifest		(AcbProject		*project,
+							 AcbManifest		*manifest);
+void		 acb_project_set_probe			(AcbProject		*project,
+							 AcbProbe		*probe);
+void		 acb_project_set_defaults		(AcbProject		*project,
+							 GKeyFile		*defaults);
 void		 acb_project_set_name			(AcbProject		*project,
 							 const gchar		*path);
+const gchar	*acb_project_get_name			(AcbProject		*project);
+const gchar	*acb_project_get_path			(AcbProject		*project);
+gchar		**acb_project_get_depends		(AcbProject		*project);
+gboolean	 acb_project_get_disabled		(AcbProject		*project);
+void		 acb_project_set_buffered		(AcbProject		*project,
+							 gboolean		 buffered);
+gboolean	 acb_project_get_has_changes		(AcbProject		*project);
+void		 acb_project_set_built			(AcbProject		*project);
+void		 acb_project_reset			(AcbProject		*project);
+gint64		 acb_project_get_fetch_last		(AcbProject		*project);
+guint		 acb_project_get_fetch_interval		(AcbProject		*project);
+GPtrArray	*acb_project_get_stats			(AcbProject		*project);
+const gchar	*acb_project_get_output			(AcbProject		*project);
+void		 acb_project_print			(AcbProject		*project,
+							 const gchar		*format,
+							 ...) G_GNUC_PRINTF(2,3);
 gboolean	 acb_project_clean			(AcbProject		*project,
 							 GError			**error);
 gboolean	 acb_project_update			(AcbProject		*project,
 							 GError			**error);
+gboolean	 acb_project_prefetch			(AcbProject		*project,
+							 gboolean		*fetched,
+							 GError			**error);
 gboolean	 acb_project_build			(AcbProject		*project,
 							 GError			**error);
 gboolean	 acb_project_make			(AcbProject		*project,
@@ -0,0 +1,83 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2018 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <glib.h>
+
+#include "acb-repo.h"
+#include "acb-spawn.h"
+
+/*
+ * createrepo_c --update only reads the headers of packages where the size
+ * or mtime differs from the old primary.xml, and the checksums are cached
+ * between runs. The new repodata is written into .repodata and then swapped
+ * in with a rename, so clients never see a partial repo.
+ */
+gboolean
+acb_repo_publish (const gchar *path, GError **error)
+{
+	g_autofree gchar *basename = NULL;
+	g_autofree gchar *cachedir = NULL;
+	g_autofree gchar *logfile = NULL;
+	g_autofree gchar *logname = NULL;
+	g_autofree gchar *workers = NULL;
+	g_autoptr(AcbSpawn) spawn = NULL;
+	g_autoptr(GError) error_local = NULL;
+	const gchar *argv[] = { "createrepo_c",
+				"--update",
+				"--cachedir", NULL,
+				"--workers", NULL,
+				"--quiet",
+				NULL, NULL };
+
+	g_return_val_if_fail (path != NULL, FALSE);
+
+	if (!g_file_test (path, G_FILE_TEST_IS_DIR))
+		return TRUE;
+
+	cachedir = g_build_filename (g_get_user_cache_dir (),
+				     "autocodebuild",
+				     "createrepo",
+				     NULL);
+	workers = g_strdup_printf ("%u", g_get_num_processors ());
+	argv[3] = cachedir;
+	argv[5] = workers;
+	argv[7] = path;
+
+	basename = g_path_get_basename (path);
+	logname = g_strdup_printf ("createrepo-%s.log", basename);
+	logfile = g_build_filename (g_get_user_data_dir (),
+				    "autocodebuild",
+				    logname,
+				    NULL);
+	spawn = acb_spawn_new ();
+	acb_spawn_set_logfile (spawn, logfile);
+	if (!acb_spawn_run (spawn, (gchar **) argv, &error_local)) {
+		g_autofree gchar *tail = acb_spawn_get_tail (spawn);
+		g_set_error (error, 1, 0, "failed to update %s: %s\n%s",
+			     path, error_local->message, tail);
+		return FALSE;
+	}
+	return TRUE;
+}
@@ -0,0 +1,716 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2018 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <glib.h>
+
+#include "acb-scheduler.h"
+
+/* seconds to let a new job show up in the load figures */
+#define ACB_SCHEDULER_ADMIT_SETTLE	3
+/* longest time to back off when the machine is busy */
+#define ACB_SCHEDULER_ADMIT_BACKOFF_MAX	30
+
+typedef enum {
+	ACB_SCHEDULER_STATE_PENDING,
+	ACB_SCHEDULER_STATE_RUNNING,
+	ACB_SCHEDULER_STATE_WAITING,
+	ACB_SCHEDULER_STATE_SUCCESS,
+	ACB_SCHEDULER_STATE_FAILED,
+	ACB_SCHEDULER_STATE_DISABLED,
+	ACB_SCHEDULER_STATE_SKIPPED,
+	ACB_SCHEDULER_STATE_UNCHANGED,
+	ACB_SCHEDULER_STATE_LAST
+} AcbSchedulerState;
+
+typedef enum {
+	ACB_SCHEDULER_STAGE_CLEAN,
+	ACB_SCHEDULER_STAGE_UPDATE,
+	ACB_SCHEDULER_STAGE_MAKE,
+	ACB_SCHEDULER_STAGE_BUILD,
+	ACB_SCHEDULER_STAGE_LAST
+} AcbSchedulerStage;
+
+typedef struct _AcbSchedulerItem AcbSchedulerItem;
+struct _AcbSchedulerItem {
+	AcbProject		*project;
+	AcbSchedulerState	 state;
+	AcbSchedulerStage	 stage;
+	gchar			*error_msg;
+	GPtrArray		*depends;	/* of AcbSchedulerItem */
+	GPtrArray		*rdepends;	/* of AcbSchedulerItem */
+	guint			 blocked;	/* unfinished depends */
+	guint			 height;	/* longest chain of rdepends */
+	guint			 idx;
+	AcbSchedulerItem	*item_failed;	/* upstream failure */
+};
+
+typedef struct
+{
+	GPtrArray		*items;
+	GThreadPool		*pool_cpu;
+	GThreadPool		*pool_io;
+	GMutex			 mutex;
+	GCond			 cond;
+	guint			 jobs;
+	guint			 io_jobs;
+	guint			 pending;
+	guint			 running_cpu;
+	gint64			 last_admit;
+	AcbSchedulerFlags	 flags;
+	AcbLoad			*load;
+	AcbJobserver		*jobserver;
+} AcbSchedulerPrivate;
+
+G_DEFINE_TYPE_WITH_PRIVATE (AcbScheduler, acb_scheduler, G_TYPE_OBJECT)
+
+#define GET_PRIVATE(o) (acb_scheduler_get_instance_private (o))
+
+static void
+acb_scheduler_item_free (AcbSchedulerItem *item)
+{
+	g_object_unref (item->project);
+	g_ptr_array_unref (item->depends);
+	g_ptr_array_unref (item->rdepends);
+	g_free (item->error_msg);
+	g_free (item);
+}
+
+static AcbSchedulerFlags
+acb_scheduler_stage_to_flag (AcbSchedulerStage stage)
+{
+	if (stage == ACB_SCHEDULER_STAGE_CLEAN)
+		return ACB_SCHEDULER_FLAG_CLEAN;
+	if (stage == ACB_SCHEDULER_STAGE_UPDATE)
+		return ACB_SCHEDULER_FLAG_UPDATE;
+	if (stage == ACB_SCHEDULER_STAGE_MAKE)
+		return ACB_SCHEDULER_FLAG_MAKE;
+	if (stage == ACB_SCHEDULER_STAGE_BUILD)
+		return ACB_SCHEDULER_FLAG_BUILD;
+	return ACB_SCHEDULER_FLAG_NONE;
+}
+
+/* mostly waiting on the network rather than the CPU */
+static gboolean
+acb_scheduler_stage_is_io (AcbSchedulerStage stage)
+{
+	return stage == ACB_SCHEDULER_STAGE_UPDATE;
+}
+
+/* has to use the output of the projects it depends on */
+static gboolean
+acb_scheduler_stage_needs_depends (AcbSchedulerStage stage)
+{
+	return stage == ACB_SCHEDULER_STAGE_MAKE ||
+	       stage == ACB_SCHEDULER_STAGE_BUILD;
+}
+
+void
+acb_scheduler_set_jobs (AcbScheduler *scheduler, guint jobs)
+{
+	AcbSchedulerPrivate *priv = GET_PRIVATE (scheduler);
+	g_return_if_fail (ACB_IS_SCHEDULER (scheduler));
+	priv->jobs = jobs;
+}
+
+void
+acb_scheduler_set_io_jobs (AcbScheduler *scheduler, guint io_jobs)
+{
+	AcbSchedulerPrivate *priv = GET_PRIVATE (scheduler);
+	g_return_if_fail (ACB_IS_SCHEDULER (scheduler));
+	priv->io_jobs = io_jobs;
+}
+
+void
+acb_scheduler_set_load (AcbScheduler *scheduler, AcbLoad *load)
+{
+	AcbSchedulerPrivate *priv = GET_PRIVATE (scheduler);
+	g_return_if_fail (ACB_IS_SCHEDULER (scheduler));
+	g_set_object (&priv->load, load);
+}
+
+void
+acb_scheduler_set_jobserver (AcbScheduler *scheduler, AcbJobserver *jobserver)
+{
+	AcbSchedulerPrivate *priv = GET_PRIVATE (scheduler);
+	g_return_if_fail (ACB_IS_SCHEDULER (scheduler));
+	g_set_object (&priv->jobserver, jobserver);
+}
+
+void
+acb_scheduler_set_flags (AcbScheduler *scheduler, AcbSchedulerFlags flags)
+{
+	AcbSchedulerPrivate *priv = GET_PRIVATE (scheduler);
+	g_return_if_fail (ACB_IS_SCHEDULER (scheduler));
+	priv->flags = flags;
+}
+
+void
+acb_scheduler_add_project (AcbScheduler *scheduler, AcbProject *project)
+{
+	AcbSchedulerPrivate *priv = GET_PRIVATE (scheduler);
+	AcbSchedulerItem *item;
+
+	g_return_if_fail (ACB_IS_SCHEDULER (scheduler));
+	g_return_if_fail (ACB_IS_PROJECT (project));
+
+	item = g_new0 (AcbSchedulerItem, 1);
+	item->project = g_object_ref (project);
+	item->state = ACB_SCHEDULER_STATE_PENDING;
+	item->depends = g_ptr_array_new ();
+	item->rdepends = g_ptr_array_new ();
+	item->idx = priv->items->len;
+	g_ptr_array_add (priv->items, item);
+}
+
+static gboolean
+acb_scheduler_item_run_stage (AcbSchedulerItem *item, GError **error)
+{
+	if (item->stage == ACB_SCHEDULER_STAGE_CLEAN) {
+		if (!acb_project_clean (item->project, error)) {
+			g_prefix_error (error, "Failed to clean: ");
+			return FALSE;
+		}
+	}
+	if (item->stage == ACB_SCHEDULER_STAGE_UPDATE) {
+		if (!acb_project_update (item->project, error)) {
+			g_prefix_error (error, "Failed to update: ");
+			return FALSE;
+		}
+	}
+	if (item->stage == ACB_SCHEDULER_STAGE_MAKE) {
+		if (!acb_project_make (item->project, error)) {
+			g_prefix_error (error, "Failed to make: ");
+			return FALSE;
+		}
+	}
+	if (item->stage == ACB_SCHEDULER_STAGE_BUILD) {
+		if (!acb_project_build (item->project, error)) {
+			g_prefix_error (error, "Failed to build: ");
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+static void acb_scheduler_item_finished (AcbScheduler *scheduler, AcbSchedulerItem *item);
+
+/* must be called with the mutex held */
+static void
+acb_scheduler_item_skip (AcbScheduler *scheduler, AcbSchedulerItem *item)
+{
+	const gchar *name_failed = acb_project_get_name (item->item_failed->project);
+	item->state = ACB_SCHEDULER_STATE_SKIPPED;
+	item->error_msg = g_strdup_printf ("Skipped as %s failed", name_failed);
+	acb_project_print (item->project, "Skipping %s as %s failed\n",
+			   acb_project_get_name (item->project), name_failed);
+	acb_scheduler_item_finished (scheduler, item);
+}
+
+/* must be called with the mutex held */
+static void
+acb_scheduler_item_next (AcbScheduler *scheduler, AcbSchedulerItem *item)
+{
+	AcbSchedulerPrivate *priv = GET_PRIVATE (scheduler);
+	GThreadPool *pool;
+
+	/* find the next stage that was asked for */
+	while (item->stage < ACB_SCHEDULER_STAGE_LAST &&
+	       (priv->flags & acb_scheduler_stage_to_flag (item->stage)) == 0)
+		item->stage++;
+	if (item->stage == ACB_SCHEDULER_STAGE_LAST) {
+		item->state = ACB_SCHEDULER_STATE_SUCCESS;
+		if (priv->flags & (ACB_SCHEDULER_FLAG_MAKE | ACB_SCHEDULER_FLAG_BUILD))
+			acb_project_set_built (item->project);
+		acb_scheduler_item_finished (scheduler, item);
+		return;
+	}
+
+	/* wait for the projects we build against */
+	if (acb_scheduler_stage_needs_depends (item->stage)) {
+		if (item->item_failed != NULL) {
+			acb_scheduler_item_skip (scheduler, item);
+			return;
+		}
+		if (item->blocked > 0) {
+			item->state = ACB_SCHEDULER_STATE_WAITING;
+			return;
+		}
+	}
+
+	/* I/O stages have their own pool so they overlap with builds */
+	pool = priv->pool_cpu;
+	if (priv->pool_io != NULL && acb_scheduler_stage_is_io (item->stage))
+		pool = priv->pool_io;
+	item->state = ACB_SCHEDULER_STATE_RUNNING;
+	g_thread_pool_push (pool, item, NULL);
+}
+
+/* must be called with the mutex held */
+static void
+acb_scheduler_item_skip_rdepends (AcbScheduler *scheduler,
+				  AcbSchedulerItem *item,
+				  AcbSchedulerItem *item_failed)
+{
+	guint i;
+
+	for (i = 0; i < item->rdepends->len; i++) {
+		AcbSchedulerItem *item_tmp = g_ptr_array_index (item->rdepends, i);
+		if (item_tmp->item_failed != NULL)
+			continue;
+		item_tmp->item_failed = item_failed;
+
+		/* anything already running is stopped when it needs the depends */
+		if (item_tmp->state == ACB_SCHEDULER_STATE_WAITING) {
+			acb_scheduler_item_skip (scheduler, item_tmp);
+			continue;
+		}
+		acb_scheduler_item_skip_rdepends (scheduler, item_tmp, item_failed);
+	}
+}
+
+/* must be called with the mutex held */
+static void
+acb_scheduler_item_finished (AcbScheduler *scheduler, AcbSchedulerItem *item)
+{
+	AcbSchedulerPrivate *priv = GET_PRIVATE (scheduler);
+	const gchar *output;
+	guint i;
+
+	/* only print the buffered output when complete */
+	output = acb_project_get_output (item->project);
+	if (output != NULL)
+		g_print ("%s", output);
+	if (item->state == ACB_SCHEDULER_STATE_FAILED)
+		g_print ("%s\n", item->error_msg);
+	priv->pending--;
+	g_cond_broadcast (&priv->cond);
+
+	/* only the downstream projects are affected by a failure */
+	if (item->state == ACB_SCHEDULER_STATE_FAILED) {
+		acb_scheduler_item_skip_rdepends (scheduler, item, item);
+		return;
+	}
+	if (item->state == ACB_SCHEDULER_STATE_SKIPPED) {
+		acb_scheduler_item_skip_rdepends (scheduler, item, item->item_failed);
+		return;
+	}
+
+	/* release anything waiting on this project */
+	for (i = 0; i < item->rdepends->len; i++) {
+		AcbSchedulerItem *item_tmp = g_ptr_array_index (item->rdepends, i);
+		if (--item_tmp->blocked == 0 &&
+		    item_tmp->state == ACB_SCHEDULER_STATE_WAITING)
+			acb_scheduler_item_next (scheduler, item_tmp);
+	}
+}
+
+/* blocks until the machine has enough resources for another build */
+static void
+acb_scheduler_item_admit (AcbScheduler *scheduler, AcbSchedulerItem *item)
+{
+	AcbSchedulerPrivate *priv = GET_PRIVATE (scheduler);
+	gint64 backoff = 1;
+
+	g_mutex_lock (&priv->mutex);
+	while (priv->load != NULL &&
+	       priv->running_cpu > 0 &&
+	       acb_load_has_limits (priv->load)) {
+		gint64 now = g_get_monotonic_time ();
+		gint64 settle = priv->last_admit + ACB_SCHEDULER_ADMIT_SETTLE * G_USEC_PER_SEC;
+		g_autofree gchar *reason = NULL;
+
+		/* the last job we started is not reflected in the figures yet */
+		if (now < settle) {
+			g_cond_wait_until (&priv->cond, &priv->mutex, settle);
+			continue;
+		}
+		if (!acb_load_is_busy (priv->load, &reason))
+			break;
+
+		/* wait for a job to finish, or for the pressure to drop */
+		g_debug ("delaying %s as %s, retrying in %" G_GINT64_FORMAT "s",
+			 acb_project_get_name (item->project), reason, backoff);
+		g_cond_wait_until (&priv->cond, &priv->mutex,
+				   now + backoff * G_USEC_PER_SEC);
+		backoff = MIN (backoff * 2, ACB_SCHEDULER_ADMIT_BACKOFF_MAX);
+	}
+	priv->running_cpu++;
+	priv->last_admit = g_get_monotonic_time ();
+	g_mutex_unlock (&priv->mutex);
+}
+
+static void
+acb_scheduler_worker_cb (gpointer data, gpointer user_data)
+{
+	AcbSchedulerItem *item = (AcbSchedulerItem *) data;
+	AcbScheduler *scheduler = ACB_SCHEDULER (user_data);
+	AcbSchedulerPrivate *priv = GET_PRIVATE (scheduler);
+	gboolean is_io = acb_scheduler_stage_is_io (item->stage);
+	gboolean has_token = FALSE;
+	gboolean ret;
+	g_autoptr(GError) error = NULL;
+
+	/* each build holds one jobserver token for the make it runs */
+	if (!is_io && priv->jobserver != NULL) {
+		if (!acb_jobserver_acquire (priv->jobserver, &error)) {
+			g_warning ("%s", error->message);
+			g_clear_error (&error);
+		} else {
+			has_token = TRUE;
+		}
+	}
+	if (!is_io)
+		acb_scheduler_item_admit (scheduler, item);
+	ret = acb_scheduler_item_run_stage (item, &error);
+	if (has_token)
+		acb_jobserver_release (priv->jobserver);
+
+	/* either move on to the next stage or give up */
+	g_mutex_lock (&priv->mutex);
+	if (!is_io)
+		priv->running_cpu--;
+	if (!ret) {
+		item->state = ACB_SCHEDULER_STATE_FAILED;
+		item->error_msg = g_strdup (error->message);
+		acb_scheduler_item_finished (scheduler, item);
+	} else if (item->stage == ACB_SCHEDULER_STAGE_UPDATE &&
+		   (priv->flags & ACB_SCHEDULER_FLAG_ONLY_CHANGED) > 0 &&
+		   !acb_project_get_has_changes (item->project)) {
+		/* nothing new upstream, so the last build is still good */
+		item->state = ACB_SCHEDULER_STATE_UNCHANGED;
+		acb_scheduler_item_finished (scheduler, item);
+	} else {
+		item->stage++;
+		acb_scheduler_item_next (scheduler, item);
+	}
+	g_mutex_unlock (&priv->mutex);
+}
+
+static guint
+acb_scheduler_item_get_height (AcbSchedulerItem *item)
+{
+	guint i;
+
+	/* already calculated */
+	if (item->height > 0)
+		return item->height;
+	item->height = 1;
+	for (i = 0; i < item->rdepends->len; i++) {
+		AcbSchedulerItem *item_tmp = g_ptr_array_index (item->rdepends, i);
+		item->height = MAX (item->height,
+				    acb_scheduler_item_get_height (item_tmp) + 1);
+	}
+	return item->height;
+}
+
+static void
+acb_scheduler_resolve_depends (AcbScheduler *scheduler)
+{
+	AcbSchedulerPrivate *priv = GET_PRIVATE (scheduler);
+	guint i;
+	guint j;
+	g_autoptr(GHashTable) hash = NULL;
+	g_autofree guint *indegree = NULL;
+	g_autoptr(GPtrArray) queue = NULL;
+
+	/* map each name to an item */
+	hash = g_hash_table_new (g_str_hash, g_str_equal);
+	for (i = 0; i < priv->items->len; i++) {
+		AcbSchedulerItem *item = g_ptr_array_index (priv->items, i);
+		g_hash_table_insert (hash,
+				     (gpointer) acb_project_get_name (item->project),
+				     item);
+	}
+
+	/* add the edges */
+	for (i = 0; i < priv->items->len; i++) {
+		AcbSchedulerItem *item = g_ptr_array_index (priv->items, i);
+		gchar **depends = acb_project_get_depends (item->project);
+		if (depends == NULL)
+			continue;
+		for (j = 0; depends[j] != NULL; j++) {
+			AcbSchedulerItem *item_dep = g_hash_table_lookup (hash, depends[j]);
+			if (item_dep == NULL) {
+				g_debug ("%s depends on %s which is not being processed",
+					 acb_project_get_name (item->project),
+					 depends[j]);
+				continue;
+			}
+			if (item_dep == item || g_ptr_array_find (item->depends, item_dep, NULL))
+				continue;
+			g_ptr_array_add (item->depends, item_dep);
+			g_ptr_array_add (item_dep->rdepends, item);
+			item->blocked++;
+		}
+	}
+
+	/* check there are no cycles by doing a topological walk */
+	indegree = g_new0 (guint, priv->items->len);
+	queue = g_ptr_array_new ();
+	for (i = 0; i < priv->items->len; i++) {
+		AcbSchedulerItem *item = g_ptr_array_index (priv->items, i);
+		indegree[item->idx] = item->blocked;
+		if (item->blocked == 0)
+			g_ptr_array_add (queue, item);
+	}
+	for (i = 0; i < queue->len; i++) {
+		AcbSchedulerItem *item = g_ptr_array_index (queue, i);
+		for (j = 0; j < item->rdepends->len; j++) {
+			AcbSchedulerItem *item_tmp = g_ptr_array_index (item->rdepends, j);
+			if (--indegree[item_tmp->idx] == 0)
+				g_ptr_array_add (queue, item_tmp);
+		}
+	}
+
+	/* anything not visited is in, or depends on, a cycle */
+	for (i = 0; i < priv->items->len; i++) {
+		AcbSchedulerItem *item = g_ptr_array_index (priv->items, i);
+		if (indegree[item->idx] == 0)
+			continue;
+		g_print ("Not processing %s as it is part of a dependency cycle\n",
+			 acb_project_get_name (item->project));
+		item->state = ACB_SCHEDULER_STATE_FAILED;
+		item->error_msg = g_strdup ("Dependency cycle");
+	}
+
+	/* prefer the projects that unblock the most work */
+	for (i = 0; i < priv->items->len; i++) {
+		AcbSchedulerItem *item = g_ptr_array_index (priv->items, i);
+		acb_scheduler_item_get_height (item);
+	}
+}
+
+static gint
+acb_scheduler_item_sort_cb (gconstpointer a, gconstpointer b, gpointer user_data)
+{
+	AcbSchedulerItem *item1 = (AcbSchedulerItem *) a;
+	AcbSchedulerItem *item2 = (AcbSchedulerItem *) b;
+	if (item1->height != item2->height)
+		return item1->height > item2->height ? -1 : 1;
+	if (item1->idx != item2->idx)
+		return item1->idx < item2->idx ? -1 : 1;
+	return 0;
+}
+
+gboolean
+acb_scheduler_run (AcbScheduler *scheduler, GError **error)
+{
+	AcbSchedulerPrivate *priv = GET_PRIVATE (scheduler);
+	guint i;
+	guint jobs;
+
+	g_return_val_if_fail (ACB_IS_SCHEDULER (scheduler), FALSE);
+
+	/* nothing to do */
+	if (priv->items->len == 0)
+		return TRUE;
+
+	/* build the dependency graph */
+	acb_scheduler_resolve_depends (scheduler);
+
+	/* zero means one worker per CPU */
+	jobs = priv->jobs;
+	if (jobs == 0)
+		jobs = g_get_num_processors ();
+	jobs = MIN (jobs, priv->items->len);
+
+	/* keep the output of each project together */
+	for (i = 0; i < priv->items->len; i++) {
+		AcbSchedulerItem *item = g_ptr_array_index (priv->items, i);
+		acb_project_set_buffered (item->project,
+					  jobs > 1 || priv->io_jobs > 0);
+	}
+
+	/* CPU-bound stages */
+	priv->pool_cpu = g_thread_pool_new (acb_scheduler_worker_cb, scheduler,
+					    (gint) jobs, TRUE, error);
+	if (priv->pool_cpu == NULL)
+		return FALSE;
+	g_thread_pool_set_sort_function (priv->pool_cpu, acb_scheduler_item_sort_cb, NULL);
+
+	/* I/O-bound stages, otherwise these share the CPU pool */
+	if (priv->io_jobs > 0) {
+		priv->pool_io = g_thread_pool_new (acb_scheduler_worker_cb, scheduler,
+						   (gint) MIN (priv->io_jobs, priv->items->len),
+						   TRUE, error);
+		if (priv->pool_io == NULL) {
+			g_thread_pool_free (priv->pool_cpu, TRUE, TRUE);
+			priv->pool_cpu = NULL;
+			return FALSE;
+		}
+		g_thread_pool_set_sort_function (priv->pool_io, acb_scheduler_item_sort_cb, NULL);
+	}
+
+	/* queue the first stage of everything */
+	g_mutex_lock (&priv->mutex);
+	for (i = 0; i < priv->items->len; i++) {
+		AcbSchedulerItem *item = g_ptr_array_index (priv->items, i);
+		if (item->state == ACB_SCHEDULER_STATE_PENDING)
+			priv->pending++;
+	}
+	for (i = 0; i < priv->items->len; i++) {
+		AcbSchedulerItem *item = g_ptr_array_index (priv->items, i);
+		if (item->state != ACB_SCHEDULER_STATE_PENDING)
+			continue;
+		if (acb_project_get_disabled (item->project)) {
+			item->state = ACB_SCHEDULER_STATE_DISABLED;
+			acb_scheduler_item_finished (scheduler, item);
+			continue;
+		}
+		acb_scheduler_item_next (scheduler, item);
+	}
+
+	/* wait for all the workers to finish */
+	while (priv->pending > 0)
+		g_cond_wait (&priv->cond, &priv->mutex);
+	g_mutex_unlock (&priv->mutex);
+
+	g_thread_pool_free (priv->pool_cpu, FALSE, TRUE);
+	priv->pool_cpu = NULL;
+	if (priv->pool_io != NULL) {
+		g_thread_pool_free (priv->pool_io, FALSE, TRUE);
+		priv->pool_io = NULL;
+	}
+	return TRUE;
+}
+
+guint
+acb_scheduler_get_failed (AcbScheduler *scheduler)
+{
+	AcbSchedulerPrivate *priv = GET_PRIVATE (scheduler);
+	guint cnt = 0;
+	guint i;
+
+	g_return_val_if_fail (ACB_IS_SCHEDULER (scheduler), 0);
+
+	for (i = 0; i < priv->items->len; i++) {
+		AcbSchedulerItem *item = g_ptr_array_index (priv->items, i);
+		if (item->state == ACB_SCHEDULER_STATE_FAILED)
+			cnt++;
+	}
+	return cnt;
+}
+
+/* resources used by every command that was run */
+GPtrArray *
+acb_scheduler_get_stats (AcbScheduler *scheduler)
+{
+	AcbSchedulerPrivate *priv = GET_PRIVATE (scheduler);
+	GPtrArray *array;
+	guint i;
+	guint j;
+
+	g_return_val_if_fail (ACB_IS_SCHEDULER (scheduler), NULL);
+
+	array = g_ptr_array_new_with_free_func ((GDestroyNotify) acb_stats_free);
+	for (i = 0; i < priv->items->len; i++) {
+		AcbSchedulerItem *item = g_ptr_array_index (priv->items, i);
+		GPtrArray *stats = acb_project_get_stats (item->project);
+		for (j = 0; j < stats->len; j++)
+			g_ptr_array_add (array, acb_stats_copy (g_ptr_array_index (stats, j)));
+	}
+	return array;
+}
+
+void
+acb_scheduler_print_summary (AcbScheduler *scheduler)
+{
+	AcbSchedulerPrivate *priv = GET_PRIVATE (scheduler);
+	guint cnt[ACB_SCHEDULER_STATE_LAST] = { 0 };
+	guint i;
+
+	g_return_if_fail (ACB_IS_SCHEDULER (scheduler));
+
+	for (i = 0; i < priv->items->len; i++) {
+		AcbSchedulerItem *item = g_ptr_array_index (priv->items, i);
+		cnt[item->state]++;
+	}
+	g_print ("\nSummary: %u passed, %u failed, %u skipped, %u unchanged, %u disabled\n",
+		 cnt[ACB_SCHEDULER_STATE_SUCCESS],
+		 cnt[ACB_SCHEDULER_STATE_FAILED],
+		 cnt[ACB_SCHEDULER_STATE_SKIPPED],
+		 cnt[ACB_SCHEDULER_STATE_UNCHANGED],
+		 cnt[ACB_SCHEDULER_STATE_DISABLED]);
+
+	/* just show the first line of the error */
+	for (i = 0; i < priv->items->len; i++) {
+		AcbSchedulerItem *item = g_ptr_array_index (priv->items, i);
+		g_auto(GStrv) lines = NULL;
+		if (item->state != ACB_SCHEDULER_STATE_FAILED &&
+		    item->state != ACB_SCHEDULER_STATE_SKIPPED)
+			continue;
+		lines = g_strsplit (item->error_msg, "\n", 2);
+		g_print ("  %s %s: %s\n",
+			 item->state == ACB_SCHEDULER_STATE_FAILED ? "FAILED" : "SKIPPED",
+			 acb_project_get_name (item->project), lines[0]);
+	}
+}
+
+static void
+acb_scheduler_finalize (GObject *object)
+{
+	AcbScheduler *scheduler;
+	AcbSchedulerPrivate *priv;
+
+	g_return_if_fail (object != NULL);
+	g_return_if_fail (ACB_IS_SCHEDULER (object));
+	scheduler = ACB_SCHEDULER (object);
+	priv = GET_PRIVATE (scheduler);
+
+	g_ptr_array_unref (priv->items);
+	if (priv->load != NULL)
+		g_object_unref (priv->load);
+	if (priv->jobserver != NULL)
+		g_object_unref (priv->jobserver);
+	g_mutex_clear (&priv->mutex);
+	g_cond_clear (&priv->cond);
+
+	G_OBJECT_CLASS (acb_scheduler_parent_class)->finalize (object);
+}
+
+static void
+acb_scheduler_class_init (AcbSchedulerClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->finalize = acb_scheduler_finalize;
+}
+
+static void
+acb_scheduler_init (AcbScheduler *scheduler)
+{
+	AcbSchedulerPrivate *priv = GET_PRIVATE (scheduler);
+	priv->items = g_ptr_array_new_with_free_func ((GDestroyNotify) acb_scheduler_item_free);
+	priv->jobs = 1;
+	g_mutex_init (&priv->mutex);
+	g_cond_init (&priv->cond);
+}
+
+AcbScheduler *
+acb_scheduler_new (void)
+{
+	AcbScheduler *scheduler;
+	scheduler = g_object_new (ACB_TYPE_SCHEDULER, NULL);
+	return ACB_SCHEDULER (scheduler);
+}
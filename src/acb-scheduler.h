@@ -0,0 +1,71 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2018 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __ACB_SCHEDULER_H
+#define __ACB_SCHEDULER_H
+
+#include <glib-object.h>
+
+#include "acb-load.h"
+#include "acb-project.h"
+
+G_BEGIN_DECLS
+
+#define ACB_TYPE_SCHEDULER (acb_scheduler_get_type ())
+G_DECLARE_DERIVABLE_TYPE (AcbScheduler, acb_scheduler, ACB, SCHEDULER, GObject)
+
+struct _AcbSchedulerClass
+{
+	GObjectClass		parent_class;
+};
+
+typedef enum {
+	ACB_SCHEDULER_FLAG_NONE		= 0,
+	ACB_SCHEDULER_FLAG_CLEAN	= 1 << 0,
+	ACB_SCHEDULER_FLAG_UPDATE	= 1 << 1,
+	ACB_SCHEDULER_FLAG_MAKE		= 1 << 2,
+	ACB_SCHEDULER_FLAG_BUILD	= 1 << 3,
+	ACB_SCHEDULER_FLAG_ONLY_CHANGED	= 1 << 4,
+	ACB_SCHEDULER_FLAG_LAST
+} AcbSchedulerFlags;
+
+AcbScheduler	*acb_scheduler_new			(void);
+void		 acb_scheduler_set_jobs			(AcbScheduler		*scheduler,
+							 guint			 jobs);
+void		 acb_scheduler_set_io_jobs		(AcbScheduler		*scheduler,
+							 guint			 io_jobs);
+void		 acb_scheduler_set_load			(AcbScheduler		*scheduler,
+							 AcbLoad		*load);
+void		 acb_scheduler_set_jobserver		(AcbScheduler		*scheduler,
+							 AcbJobserver		*jobserver);
+void		 acb_scheduler_set_flags		(AcbScheduler		*scheduler,
+							 AcbSchedulerFlags	 flags);
+void		 acb_scheduler_add_project		(AcbScheduler		*scheduler,
+							 AcbProject		*project);
+gboolean	 acb_scheduler_run			(AcbScheduler		*scheduler,
+							 GError			**error);
+GPtrArray	*acb_scheduler_get_stats		(AcbScheduler		*scheduler);
+guint		 acb_scheduler_get_failed		(AcbScheduler		*scheduler);
+void		 acb_scheduler_print_summary		(AcbScheduler		*scheduler);
+
+G_END_DECLS
+
+#endif /* __ACB_SCHEDULER_H */
@@ -0,0 +1,557 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2018 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "acb-spawn.h"
+
+/* only the end of the output is kept in memory for the error message */
+#define ACB_SPAWN_TAIL_LINES		20
+#define ACB_SPAWN_LINE_MAX		1024
+
+/* how often to check for a timeout or cancellation, in ms */
+#define ACB_SPAWN_POLL_INTERVAL		500
+
+/* how long to wait after SIGTERM before using SIGKILL, in seconds */
+#define ACB_SPAWN_KILL_GRACE		10
+
+/* bumped from the signal handler, so no locking */
+static volatile gint acb_spawn_cancel_serial = 0;
+static volatile gint acb_spawn_cancel_shutdown = 0;
+
+typedef struct
+{
+	gchar			*directory;
+	gchar			**envp;
+	gchar			*logfile;
+	gint			 fd_log;
+	GQueue			*tail;		/* of gchar* */
+	GString			*partial[2];	/* stdout, stderr */
+	guint64			 stdout_size;
+	AcbStats		 stats;
+	guint			 timeout;	/* s */
+	GPid			 pid;
+	gint			 cancel_serial;
+	gint64			 deadline;
+	gint64			 killed_at;
+	gchar			*killed_reason;
+	AcbSpawnLineFunc	 line_func;
+	gpointer		 line_func_data;
+} AcbSpawnPrivate;
+
+G_DEFINE_TYPE_WITH_PRIVATE (AcbSpawn, acb_spawn, G_TYPE_OBJECT)
+
+#define GET_PRIVATE(o) (acb_spawn_get_instance_private (o))
+
+void
+acb_spawn_set_directory (AcbSpawn *spawn, const gchar *directory)
+{
+	AcbSpawnPrivate *priv = GET_PRIVATE (spawn);
+	g_return_if_fail (ACB_IS_SPAWN (spawn));
+	g_free (priv->directory);
+	priv->directory = g_strdup (directory);
+}
+
+void
+acb_spawn_set_environ (AcbSpawn *spawn, gchar **envp)
+{
+	AcbSpawnPrivate *priv = GET_PRIVATE (spawn);
+	g_return_if_fail (ACB_IS_SPAWN (spawn));
+	g_strfreev (priv->envp);
+	priv->envp = g_strdupv (envp);
+}
+
+void
+acb_spawn_set_logfile (AcbSpawn *spawn, const gchar *logfile)
+{
+	AcbSpawnPrivate *priv = GET_PRIVATE (spawn);
+	g_return_if_fail (ACB_IS_SPAWN (spawn));
+	g_free (priv->logfile);
+	priv->logfile = g_strdup (logfile);
+}
+
+void
+acb_spawn_set_timeout (AcbSpawn *spawn, guint timeout)
+{
+	AcbSpawnPrivate *priv = GET_PRIVATE (spawn);
+	g_return_if_fail (ACB_IS_SPAWN (spawn));
+	priv->timeout = timeout;
+}
+
+/* called for each line of standard output, which may be truncated */
+void
+acb_spawn_set_line_func (AcbSpawn *spawn, AcbSpawnLineFunc func, gpointer user_data)
+{
+	AcbSpawnPrivate *priv = GET_PRIVATE (spawn);
+	g_return_if_fail (ACB_IS_SPAWN (spawn));
+	priv->line_func = func;
+	priv->line_func_data = user_data;
+}
+
+/* kills every running command; this is safe to call from a signal handler */
+void
+acb_spawn_cancel_all (gboolean shutdown)
+{
+	if (shutdown)
+		g_atomic_int_set (&acb_spawn_cancel_shutdown, 1);
+	g_atomic_int_inc (&acb_spawn_cancel_serial);
+}
+
+gboolean
+acb_spawn_is_shutdown (void)
+{
+	return g_atomic_int_get (&acb_spawn_cancel_shutdown) != 0;
+}
+
+/* program name : version, as the tools do not change during a run */
+static GHashTable *acb_spawn_versions = NULL;
+G_LOCK_DEFINE_STATIC (acb_spawn_versions);
+
+/* parses the first "x.y" from '<program> --version', or 0 if unknown */
+guint
+acb_spawn_get_version (const gchar *program)
+{
+	gpointer value;
+	guint major = 0;
+	guint minor = 0;
+	guint i;
+	gint exit_status = 0;
+	g_autofree gchar *command_line = NULL;
+	g_autofree gchar *standard_out = NULL;
+	g_auto(GStrv) split = NULL;
+
+	g_return_val_if_fail (program != NULL, 0);
+
+	G_LOCK (acb_spawn_versions);
+	if (acb_spawn_versions == NULL)
+		acb_spawn_versions = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	if (g_hash_table_lookup_extended (acb_spawn_versions, program, NULL, &value)) {
+		G_UNLOCK (acb_spawn_versions);
+		return GPOINTER_TO_UINT (value);
+	}
+	G_UNLOCK (acb_spawn_versions);
+
+	/* "git version 2.17.1" or just "0.51.2" */
+	command_line = g_strdup_printf ("%s --version", program);
+	if (g_spawn_command_line_sync (command_line, &standard_out, NULL,
+				       &exit_status, NULL) &&
+	    exit_status == 0 && standard_out != NULL) {
+		split = g_strsplit_set (standard_out, " \n", -1);
+		for (i = 0; split[i] != NULL; i++) {
+			if (!g_ascii_isdigit (split[i][0]))
+				continue;
+			if (sscanf (split[i], "%u.%u", &major, &minor) == 2)
+				break;
+			major = 0;
+			minor = 0;
+		}
+	}
+	g_debug ("%s version is %u.%u", program, major, minor);
+
+	G_LOCK (acb_spawn_versions);
+	g_hash_table_insert (acb_spawn_versions, g_strdup (program),
+			     GUINT_TO_POINTER (ACB_SPAWN_VERSION (major, minor)));
+	G_UNLOCK (acb_spawn_versions);
+	return ACB_SPAWN_VERSION (major, minor);
+}
+
+static void
+acb_spawn_child_setup_cb (gpointer user_data)
+{
+	/* own process group, so the whole tree can be killed together and
+	 * a Ctrl-C in the terminal is not delivered to it directly */
+	setpgid (0, 0);
+}
+
+static void
+acb_spawn_check_killed (AcbSpawn *spawn)
+{
+	AcbSpawnPrivate *priv = GET_PRIVATE (spawn);
+	gint64 now = g_get_monotonic_time ();
+
+	/* already sent SIGTERM, so escalate if it's being ignored */
+	if (priv->killed_reason != NULL) {
+		if (priv->killed_at > 0 &&
+		    now - priv->killed_at > ACB_SPAWN_KILL_GRACE * G_USEC_PER_SEC) {
+			g_debug ("process group %i ignored SIGTERM", priv->pid);
+			kill (-priv->pid, SIGKILL);
+			priv->killed_at = 0;
+		}
+		return;
+	}
+	if (g_atomic_int_get (&acb_spawn_cancel_serial) != priv->cancel_serial) {
+		priv->killed_reason = g_strdup ("cancelled");
+	} else if (priv->deadline > 0 && now > priv->deadline) {
+		priv->killed_reason = g_strdup_printf ("timed out after %us",
+						       priv->timeout);
+	} else {
+		return;
+	}
+	kill (-priv->pid, SIGTERM);
+	priv->killed_at = now;
+}
+
+static void
+acb_spawn_tail_add (AcbSpawn *spawn, guint idx, GString *line)
+{
+	AcbSpawnPrivate *priv = GET_PRIVATE (spawn);
+	if (idx == 0 && priv->line_func != NULL)
+		priv->line_func (line->str, priv->line_func_data);
+	g_queue_push_tail (priv->tail, g_strndup (line->str, line->len));
+	while (g_queue_get_length (priv->tail) > ACB_SPAWN_TAIL_LINES)
+		g_free (g_queue_pop_head (priv->tail));
+	g_string_truncate (line, 0);
+}
+
+static gboolean
+acb_spawn_write_log (AcbSpawn *spawn, const gchar *buf, gsize len, GError **error)
+{
+	AcbSpawnPrivate *priv = GET_PRIVATE (spawn);
+	gssize wrote;
+
+	if (priv->fd_log < 0)
+		return TRUE;
+	while (len > 0) {
+		wrote = write (priv->fd_log, buf, len);
+		if (wrote < 0 && errno == EINTR)
+			continue;
+		if (wrote < 0) {
+			g_set_error (error, 1, 0, "failed to write %s: %s",
+				     priv->logfile, g_strerror (errno));
+			return FALSE;
+		}
+		buf += wrote;
+		len -= (gsize) wrote;
+	}
+	return TRUE;
+}
+
+static void
+acb_spawn_add_data (AcbSpawn *spawn, guint idx, const gchar *buf, gsize len)
+{
+	AcbSpawnPrivate *priv = GET_PRIVATE (spawn);
+	GString *partial = priv->partial[idx];
+	gsize i;
+
+	for (i = 0; i < len; i++) {
+		if (buf[i] == '\n') {
+			acb_spawn_tail_add (spawn, idx, partial);
+			continue;
+		}
+		/* very long lines are just truncated */
+		if (partial->len < ACB_SPAWN_LINE_MAX)
+			g_string_append_c (partial, buf[i]);
+	}
+}
+
+static gboolean
+acb_spawn_read_fds (AcbSpawn *spawn, gint *fds, GError **error)
+{
+	AcbSpawnPrivate *priv = GET_PRIVATE (spawn);
+	gchar buf[4096];
+
+	while (fds[0] >= 0 || fds[1] >= 0) {
+		struct pollfd pfds[2];
+		guint i;
+		gint rc;
+
+		for (i = 0; i < 2; i++) {
+			pfds[i].fd = fds[i];
+			pfds[i].events = POLLIN;
+			pfds[i].revents = 0;
+		}
+		rc = poll (pfds, 2, ACB_SPAWN_POLL_INTERVAL);
+		acb_spawn_check_killed (spawn);
+		if (rc < 0 && errno == EINTR)
+			continue;
+		if (rc < 0) {
+			g_set_error (error, 1, 0, "failed to poll: %s",
+				     g_strerror (errno));
+			return FALSE;
+		}
+		for (i = 0; i < 2; i++) {
+			gssize len;
+			if (fds[i] < 0 || pfds[i].revents == 0)
+				continue;
+			len = read (fds[i], buf, sizeof (buf));
+			if (len < 0 && errno == EINTR)
+				continue;
+			if (len <= 0) {
+				close (fds[i]);
+				fds[i] = -1;
+				continue;
+			}
+			if (i == 0)
+				priv->stdout_size += (guint64) len;
+			acb_spawn_add_data (spawn, i, buf, (gsize) len);
+			if (!acb_spawn_write_log (spawn, buf, (gsize) len, error))
+				return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+gboolean
+acb_spawn_run (AcbSpawn *spawn, gchar **argv, GError **error)
+{
+	AcbSpawnPrivate *priv = GET_PRIVATE (spawn);
+	GPid pid;
+	gboolean ret;
+	gint fds[2] = { -1, -1 };
+	gint status = 0;
+	gint64 start;
+	guint wait_ms = 1;
+	guint i;
+	struct rusage ru;
+
+	g_return_val_if_fail (ACB_IS_SPAWN (spawn), FALSE);
+	g_return_val_if_fail (argv != NULL, FALSE);
+
+	/* reset */
+	while (!g_queue_is_empty (priv->tail))
+		g_free (g_queue_pop_head (priv->tail));
+	for (i = 0; i < 2; i++)
+		g_string_truncate (priv->partial[i], 0);
+	priv->stdout_size = 0;
+	memset (&priv->stats, 0, sizeof (priv->stats));
+	g_clear_pointer (&priv->killed_reason, g_free);
+	priv->killed_at = 0;
+	priv->cancel_serial = g_atomic_int_get (&acb_spawn_cancel_serial);
+
+	/* the whole batch is being stopped */
+	if (acb_spawn_is_shutdown ()) {
+		g_set_error_literal (error, 1, 0, "cancelled");
+		return FALSE;
+	}
+
+	/* stream the output straight to the log */
+	if (priv->logfile != NULL) {
+		priv->fd_log = g_open (priv->logfile,
+				       O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+				       0644);
+		if (priv->fd_log < 0) {
+			g_set_error (error, 1, 0, "failed to open %s: %s",
+				     priv->logfile, g_strerror (errno));
+			return FALSE;
+		}
+	}
+
+	start = g_get_monotonic_time ();
+	priv->deadline = 0;
+	if (priv->timeout > 0)
+		priv->deadline = start + (gint64) priv->timeout * G_USEC_PER_SEC;
+	if (!g_spawn_async_with_pipes (priv->directory,
+				       argv,
+				       priv->envp,
+				       G_SPAWN_SEARCH_PATH |
+				       G_SPAWN_DO_NOT_REAP_CHILD,
+				       acb_spawn_child_setup_cb,
+				       NULL,
+				       &pid,
+				       NULL,
+				       &fds[0],
+				       &fds[1],
+				       error)) {
+		ret = FALSE;
+		goto out;
+	}
+
+	/* also from the parent, in case we need to kill it before it has run */
+	setpgid (pid, pid);
+
+	/* read until both pipes are closed */
+	priv->pid = pid;
+	ret = acb_spawn_read_fds (spawn, fds, error);
+	for (i = 0; i < 2; i++) {
+		if (fds[i] >= 0)
+			close (fds[i]);
+	}
+
+	/* any unterminated last line */
+	for (i = 0; i < 2; i++) {
+		if (priv->partial[i]->len > 0)
+			acb_spawn_tail_add (spawn, i, priv->partial[i]);
+	}
+
+	/* don't leave anything behind if the read failed */
+	if (!ret && priv->killed_reason == NULL)
+		kill (-pid, SIGKILL);
+
+	/* reap the child, getting the resources it and its children used;
+	 * it may have closed its pipes and still be running, so the timeout
+	 * and cancellation are checked here too */
+	memset (&ru, 0, sizeof (ru));
+	for (;;) {
+		pid_t rc = wait4 (pid, &status, WNOHANG, &ru);
+		if (rc == pid)
+			break;
+		if (rc < 0 && errno == EINTR)
+			continue;
+		if (rc < 0) {
+			if (ret) {
+				g_set_error (error, 1, 0, "failed to wait for child: %s",
+					     g_strerror (errno));
+				ret = FALSE;
+			}
+			break;
+		}
+		acb_spawn_check_killed (spawn);
+
+		/* it usually exits just after closing the pipes */
+		g_usleep (wait_ms * 1000);
+		wait_ms = MIN (wait_ms * 2, ACB_SPAWN_POLL_INTERVAL);
+	}
+	g_spawn_close_pid (pid);
+	priv->pid = 0;
+	priv->stats.wall = (gdouble) (g_get_monotonic_time () - start) / G_USEC_PER_SEC;
+	priv->stats.user = (gdouble) ru.ru_utime.tv_sec + (gdouble) ru.ru_utime.tv_usec / G_USEC_PER_SEC;
+	priv->stats.system = (gdouble) ru.ru_stime.tv_sec + (gdouble) ru.ru_stime.tv_usec / G_USEC_PER_SEC;
+	priv->stats.maxrss = (guint64) ru.ru_maxrss;
+	priv->stats.inblock = (guint64) ru.ru_inblock;
+	priv->stats.oublock = (guint64) ru.ru_oublock;
+	if (!ret)
+		goto out;
+
+	/* we killed it */
+	if (priv->killed_reason != NULL) {
+		g_set_error_literal (error, 1, 0, priv->killed_reason);
+		ret = FALSE;
+		goto out;
+	}
+
+	/* fail if we got the wrong retval */
+	if (WIFSIGNALED (status)) {
+		g_set_error (error, 1, 0, "killed by signal %i",
+			     WTERMSIG (status));
+		ret = FALSE;
+		goto out;
+	}
+	if (!WIFEXITED (status) || WEXITSTATUS (status) != 0) {
+		g_set_error (error, 1, 0, "exited with status %i",
+			     WEXITSTATUS (status));
+		ret = FALSE;
+		goto out;
+	}
+out:
+	if (priv->fd_log >= 0) {
+		close (priv->fd_log);
+		priv->fd_log = -1;
+	}
+	return ret;
+}
+
+/* the last few lines of output, for showing on failure */
+gchar *
+acb_spawn_get_tail (AcbSpawn *spawn)
+{
+	AcbSpawnPrivate *priv = GET_PRIVATE (spawn);
+	GList *l;
+	GString *str = g_string_new (NULL);
+
+	g_return_val_if_fail (ACB_IS_SPAWN (spawn), NULL);
+
+	for (l = priv->tail->head; l != NULL; l = l->next) {
+		g_string_append (str, l->data);
+		g_string_append_c (str, '\n');
+	}
+	return g_string_free (str, FALSE);
+}
+
+/* resources used by the last command */
+const AcbStats *
+acb_spawn_get_stats (AcbSpawn *spawn)
+{
+	AcbSpawnPrivate *priv = GET_PRIVATE (spawn);
+	g_return_val_if_fail (ACB_IS_SPAWN (spawn), NULL);
+	return &priv->stats;
+}
+
+guint64
+acb_spawn_get_stdout_size (AcbSpawn *spawn)
+{
+	AcbSpawnPrivate *priv = GET_PRIVATE (spawn);
+	g_return_val_if_fail (ACB_IS_SPAWN (spawn), 0);
+	return priv->stdout_size;
+}
+
+static void
+acb_spawn_finalize (GObject *object)
+{
+	AcbSpawn *spawn;
+	AcbSpawnPrivate *priv;
+	guint i;
+
+	g_return_if_fail (object != NULL);
+	g_return_if_fail (ACB_IS_SPAWN (object));
+	spawn = ACB_SPAWN (object);
+	priv = GET_PRIVATE (spawn);
+
+	g_free (priv->directory);
+	g_strfreev (priv->envp);
+	g_free (priv->logfile);
+	g_free (priv->killed_reason);
+	g_queue_free_full (priv->tail, g_free);
+	for (i = 0; i < 2; i++)
+		g_string_free (priv->partial[i], TRUE);
+
+	G_OBJECT_CLASS (acb_spawn_parent_class)->finalize (object);
+}
+
+static void
+acb_spawn_class_init (AcbSpawnClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->finalize = acb_spawn_finalize;
+}
+
+static void
+acb_spawn_init (AcbSpawn *spawn)
+{
+	AcbSpawnPrivate *priv = GET_PRIVATE (spawn);
+	guint i;
+	priv->fd_log = -1;
+	priv->tail = g_queue_new ();
+	for (i = 0; i < 2; i++)
+		priv->partial[i] = g_string_new (NULL);
+}
+
+AcbSpawn *
+acb_spawn_new (void)
+{
+	AcbSpawn *spawn;
+	spawn = g_object_new (ACB_TYPE_SPAWN, NULL);
+	return ACB_SPAWN (spawn);
+}
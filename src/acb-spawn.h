@@ -0,0 +1,70 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2018 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __ACB_SPAWN_H
+#define __ACB_SPAWN_H
+
+#include <glib-object.h>
+
+#include "acb-stats.h"
+
+G_BEGIN_DECLS
+
+/* for comparing against acb_spawn_get_version() */
+#define ACB_SPAWN_VERSION(major,minor)	((major) * 1000 + (minor))
+
+#define ACB_TYPE_SPAWN (acb_spawn_get_type ())
+G_DECLARE_DERIVABLE_TYPE (AcbSpawn, acb_spawn, ACB, SPAWN, GObject)
+
+struct _AcbSpawnClass
+{
+	GObjectClass		parent_class;
+};
+
+typedef void	(*AcbSpawnLineFunc)			(const gchar		*line,
+							 gpointer		 user_data);
+
+AcbSpawn	*acb_spawn_new				(void);
+void		 acb_spawn_set_directory		(AcbSpawn		*spawn,
+							 const gchar		*directory);
+void		 acb_spawn_set_environ			(AcbSpawn		*spawn,
+							 gchar			**envp);
+void		 acb_spawn_set_logfile			(AcbSpawn		*spawn,
+							 const gchar		*logfile);
+void		 acb_spawn_set_timeout			(AcbSpawn		*spawn,
+							 guint			 timeout);
+void		 acb_spawn_set_line_func		(AcbSpawn		*spawn,
+							 AcbSpawnLineFunc	 func,
+							 gpointer		 user_data);
+gboolean	 acb_spawn_run				(AcbSpawn		*spawn,
+							 gchar			**argv,
+							 GError			**error);
+gchar		*acb_spawn_get_tail			(AcbSpawn		*spawn);
+const AcbStats	*acb_spawn_get_stats			(AcbSpawn		*spawn);
+guint64		 acb_spawn_get_stdout_size		(AcbSpawn		*spawn);
+
+void		 acb_spawn_cancel_all			(gboolean		 shutdown);
+gboolean	 acb_spawn_is_shutdown			(void);
+guint		 acb_spawn_get_version			(const gchar		*program);
+
+G_END_DECLS
+
+#endif /* __ACB_SPAWN_H */
@@ -0,0 +1,164 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2018 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <glib.h>
+
+#include "acb-stats.h"
+
+AcbStats *
+acb_stats_new (void)
+{
+	return g_new0 (AcbStats, 1);
+}
+
+AcbStats *
+acb_stats_copy (const AcbStats *stats)
+{
+	AcbStats *copy = g_new0 (AcbStats, 1);
+	*copy = *stats;
+	copy->project = g_strdup (stats->project);
+	copy->stage = g_strdup (stats->stage);
+	return copy;
+}
+
+void
+acb_stats_free (AcbStats *stats)
+{
+	g_free (stats->project);
+	g_free (stats->stage);
+	g_free (stats);
+}
+
+static gint
+acb_stats_sort_wall_cb (gconstpointer a, gconstpointer b)
+{
+	AcbStats *stats1 = *((AcbStats **) a);
+	AcbStats *stats2 = *((AcbStats **) b);
+	if (stats1->wall > stats2->wall)
+		return -1;
+	if (stats1->wall < stats2->wall)
+		return 1;
+	return g_strcmp0 (stats1->project, stats2->project);
+}
+
+static gchar *
+acb_stats_format_duration (gdouble seconds)
+{
+	guint tmp = (guint) seconds;
+	if (tmp >= 3600)
+		return g_strdup_printf ("%uh%02um", tmp / 3600, (tmp % 3600) / 60);
+	if (tmp >= 60)
+		return g_strdup_printf ("%um%02us", tmp / 60, tmp % 60);
+	return g_strdup_printf ("%.1fs", seconds);
+}
+
+static void
+acb_stats_print_line (const gchar *title, AcbStats *stats)
+{
+	g_autofree gchar *wall = acb_stats_format_duration (stats->wall);
+	g_autofree gchar *user = acb_stats_format_duration (stats->user);
+	g_autofree gchar *system = acb_stats_format_duration (stats->system);
+	g_autofree gchar *maxrss = g_format_size (stats->maxrss * 1024);
+	g_autofree gchar *in = g_format_size (stats->inblock * 512);
+	g_autofree gchar *out = g_format_size (stats->oublock * 512);
+	g_print ("  %-32s %9s  user %9s  sys %9s  rss %10s  read %10s  write %10s\n",
+		 title, wall, user, system, maxrss, in, out);
+}
+
+void
+acb_stats_print_report (GPtrArray *array, guint limit)
+{
+	guint i;
+	g_autoptr(GHashTable) hash = NULL;
+	g_autoptr(GPtrArray) projects = NULL;
+	g_autoptr(GPtrArray) stages = NULL;
+
+	if (array->len == 0)
+		return;
+
+	/* add up each project */
+	hash = g_hash_table_new (g_str_hash, g_str_equal);
+	projects = g_ptr_array_new_with_free_func ((GDestroyNotify) acb_stats_free);
+	for (i = 0; i < array->len; i++) {
+		AcbStats *stats = g_ptr_array_index (array, i);
+		AcbStats *total = g_hash_table_lookup (hash, stats->project);
+		if (total == NULL) {
+			total = acb_stats_new ();
+			total->project = g_strdup (stats->project);
+			g_hash_table_insert (hash, total->project, total);
+			g_ptr_array_add (projects, total);
+		}
+		total->wall += stats->wall;
+		total->user += stats->user;
+		total->system += stats->system;
+		total->maxrss = MAX (total->maxrss, stats->maxrss);
+		total->inblock += stats->inblock;
+		total->oublock += stats->oublock;
+	}
+	g_ptr_array_sort (projects, acb_stats_sort_wall_cb);
+	g_print ("\nSlowest projects:\n");
+	for (i = 0; i < projects->len && i < limit; i++) {
+		AcbStats *stats = g_ptr_array_index (projects, i);
+		acb_stats_print_line (stats->project, stats);
+	}
+
+	/* and each stage */
+	stages = g_ptr_array_sized_new (array->len);
+	for (i = 0; i < array->len; i++)
+		g_ptr_array_add (stages, g_ptr_array_index (array, i));
+	g_ptr_array_sort (stages, acb_stats_sort_wall_cb);
+	g_print ("\nSlowest stages:\n");
+	for (i = 0; i < stages->len && i < limit; i++) {
+		AcbStats *stats = g_ptr_array_index (stages, i);
+		g_autofree gchar *title = NULL;
+		title = g_strdup_printf ("%s %s", stats->project, stats->stage);
+		acb_stats_print_line (title, stats);
+	}
+}
+
+/* tab separated, one line per stage */
+gboolean
+acb_stats_save (GPtrArray *array, const gchar *filename, GError **error)
+{
+	guint i;
+	g_autoptr(GString) str = NULL;
+
+	str = g_string_new ("#project\tstage\twall\tuser\tsystem\tmaxrss_kib\tinblock\toublock\n");
+	for (i = 0; i < array->len; i++) {
+		AcbStats *stats = g_ptr_array_index (array, i);
+		g_string_append_printf (str, "%s\t%s\t%.3f\t%.3f\t%.3f\t%"
+					G_GUINT64_FORMAT "\t%" G_GUINT64_FORMAT
+					"\t%" G_GUINT64_FORMAT "\n",
+					stats->project,
+					stats->stage,
+					stats->wall,
+					stats->user,
+					stats->system,
+					stats->maxrss,
+					stats->inblock,
+					stats->oublock);
+	}
+	return g_file_set_contents (filename, str->str, (gssize) str->len, error);
+}
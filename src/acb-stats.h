@@ -0,0 +1,53 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2018 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __ACB_STATS_H
+#define __ACB_STATS_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct {
+	gchar			*project;
+	gchar			*stage;
+	gdouble			 wall;		/* seconds */
+	gdouble			 user;		/* seconds */
+	gdouble			 system;	/* seconds */
+	guint64			 maxrss;	/* KiB */
+	guint64			 inblock;	/* 512 byte blocks */
+	guint64			 oublock;	/* 512 byte blocks */
+} AcbStats;
+
+AcbStats	*acb_stats_new				(void);
+AcbStats	*acb_stats_copy				(const AcbStats		*stats);
+void		 acb_stats_free				(AcbStats		*stats);
+void		 acb_stats_print_report			(GPtrArray		*array,
+							 guint			 limit);
+gboolean	 acb_stats_save				(GPtrArray		*array,
+							 const gchar		*filename,
+							 GError			**error);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (AcbStats, acb_stats_free)
+
+G_END_DECLS
+
+#endif /* __ACB_STATS_H */
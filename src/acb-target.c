@@ -0,0 +1,122 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2018 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <glib.h>
+
+#include "acb-target.h"
+
+/* what was built before targets could be configured */
+#define ACB_TARGET_DEFAULT_DISTRO	"fedora"
+#define ACB_TARGET_DEFAULT_RELEASE	"28"
+#define ACB_TARGET_DEFAULT_ARCH		"x86_64"
+
+AcbTarget *
+acb_target_new (const gchar *distro, const gchar *release, const gchar *arch)
+{
+	AcbTarget *target = g_new0 (AcbTarget, 1);
+	target->distro = g_strdup (distro);
+	target->release = g_strdup (release);
+	target->arch = g_strdup (arch);
+	target->id = g_strdup_printf ("%s-%s-%s", distro, release, arch);
+	return target;
+}
+
+void
+acb_target_free (AcbTarget *target)
+{
+	g_free (target->id);
+	g_free (target->distro);
+	g_free (target->release);
+	g_free (target->arch);
+	g_strfreev (target->macros);
+	g_free (target);
+}
+
+/*
+ * Each target is a group in defaults.conf, for example:
+ *
+ *  [target fedora-29-i686]
+ *  Distro=fedora
+ *  Release=29
+ *  Arch=i686
+ *  Macros=dist .fc29;fedora 29;
+ */
+GPtrArray *
+acb_target_load_all (GKeyFile *defaults)
+{
+	GPtrArray *targets;
+	guint i;
+	g_auto(GStrv) groups = NULL;
+
+	targets = g_ptr_array_new_with_free_func ((GDestroyNotify) acb_target_free);
+	if (defaults != NULL)
+		groups = g_key_file_get_groups (defaults, NULL);
+	for (i = 0; groups != NULL && groups[i] != NULL; i++) {
+		AcbTarget *target;
+		g_autofree gchar *distro = NULL;
+		g_autofree gchar *release = NULL;
+		g_autofree gchar *arch = NULL;
+
+		if (!g_str_has_prefix (groups[i], "target "))
+			continue;
+		distro = g_key_file_get_string (defaults, groups[i], "Distro", NULL);
+		release = g_key_file_get_string (defaults, groups[i], "Release", NULL);
+		arch = g_key_file_get_string (defaults, groups[i], "Arch", NULL);
+		if (distro == NULL || release == NULL || arch == NULL) {
+			g_warning ("ignoring %s as Distro, Release and Arch are required",
+				   groups[i]);
+			continue;
+		}
+		target = acb_target_new (distro, release, arch);
+		target->macros = g_key_file_get_string_list (defaults, groups[i],
+							     "Macros", NULL, NULL);
+		g_ptr_array_add (targets, target);
+	}
+
+	/* nothing configured */
+	if (targets->len == 0) {
+		g_ptr_array_add (targets, acb_target_new (ACB_TARGET_DEFAULT_DISTRO,
+							  ACB_TARGET_DEFAULT_RELEASE,
+							  ACB_TARGET_DEFAULT_ARCH));
+	}
+	return targets;
+}
+
+gchar *
+acb_target_get_repo_dir (AcbTarget *target, const gchar *rpmbuild_path)
+{
+	return g_build_filename (rpmbuild_path, "REPOS",
+				 target->distro, target->release, target->arch,
+				 NULL);
+}
+
+/* shared by all the arches of the same release */
+gchar *
+acb_target_get_srpm_repo_dir (AcbTarget *target, const gchar *rpmbuild_path)
+{
+	return g_build_filename (rpmbuild_path, "REPOS",
+				 target->distro, target->release, "SRPMS",
+				 NULL);
+}
@@ -0,0 +1,51 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2018 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __ACB_TARGET_H
+#define __ACB_TARGET_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct {
+	gchar			*id;		/* e.g. fedora-28-x86_64 */
+	gchar			*distro;
+	gchar			*release;
+	gchar			*arch;
+	gchar			**macros;	/* of "name value" */
+} AcbTarget;
+
+AcbTarget	*acb_target_new				(const gchar		*distro,
+							 const gchar		*release,
+							 const gchar		*arch);
+void		 acb_target_free			(AcbTarget		*target);
+GPtrArray	*acb_target_load_all			(GKeyFile		*defaults);
+gchar		*acb_target_get_repo_dir		(AcbTarget		*target,
+							 const gchar		*rpmbuild_path);
+gchar		*acb_target_get_srpm_repo_dir		(AcbTarget		*target,
+							 const gchar		*rpmbuild_path);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (AcbTarget, acb_target_free)
+
+G_END_DECLS
+
+#endif /* __ACB_TARGET_H */
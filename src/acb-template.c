@@ -0,0 +1,219 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2018 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <errno.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "acb-template.h"
+
+/* a variable looks like #VERSION#, anything else is copied as-is */
+typedef struct {
+	gboolean		 is_variable;
+	gchar			*text;
+} AcbTemplateSegment;
+
+typedef struct
+{
+	gchar			*filename;
+	gint64			 mtime;
+	gint64			 size;
+	GPtrArray		*segments;	/* of AcbTemplateSegment */
+	GHashTable		*values;	/* key : value */
+} AcbTemplatePrivate;
+
+G_DEFINE_TYPE_WITH_PRIVATE (AcbTemplate, acb_template, G_TYPE_OBJECT)
+
+#define GET_PRIVATE(o) (acb_template_get_instance_private (o))
+
+static void
+acb_template_segment_free (AcbTemplateSegment *segment)
+{
+	g_free (segment->text);
+	g_free (segment);
+}
+
+static void
+acb_template_add_segment (AcbTemplate *tmpl,
+			  gboolean is_variable,
+			  const gchar *text,
+			  gsize len)
+{
+	AcbTemplatePrivate *priv = GET_PRIVATE (tmpl);
+	AcbTemplateSegment *segment;
+
+	if (len == 0)
+		return;
+	segment = g_new0 (AcbTemplateSegment, 1);
+	segment->is_variable = is_variable;
+	segment->text = g_strndup (text, len);
+	g_ptr_array_add (priv->segments, segment);
+}
+
+static gboolean
+acb_template_is_variable_char (gchar c)
+{
+	return g_ascii_isupper (c) || g_ascii_isdigit (c) || c == '_';
+}
+
+static void
+acb_template_parse (AcbTemplate *tmpl, const gchar *data)
+{
+	const gchar *literal = data;
+	const gchar *p = data;
+
+	while (*p != '\0') {
+		const gchar *end;
+
+		if (*p != '#') {
+			p++;
+			continue;
+		}
+		for (end = p + 1; acb_template_is_variable_char (*end); end++);
+		if (*end != '#' || end == p + 1) {
+			p++;
+			continue;
+		}
+		acb_template_add_segment (tmpl, FALSE, literal, (gsize) (p - literal));
+		acb_template_add_segment (tmpl, TRUE, p + 1, (gsize) (end - p - 1));
+		p = end + 1;
+		literal = p;
+	}
+	acb_template_add_segment (tmpl, FALSE, literal, (gsize) (p - literal));
+}
+
+/* does nothing if the file has not changed since it was last parsed */
+gboolean
+acb_template_load_file (AcbTemplate *tmpl, const gchar *filename, GError **error)
+{
+	AcbTemplatePrivate *priv = GET_PRIVATE (tmpl);
+	GStatBuf buf;
+	g_autofree gchar *data = NULL;
+
+	g_return_val_if_fail (ACB_IS_TEMPLATE (tmpl), FALSE);
+	g_return_val_if_fail (filename != NULL, FALSE);
+
+	if (g_stat (filename, &buf) != 0) {
+		g_set_error (error, 1, 0, "failed to stat %s: %s",
+			     filename, g_strerror (errno));
+		return FALSE;
+	}
+	if (g_strcmp0 (priv->filename, filename) == 0 &&
+	    priv->mtime == (gint64) buf.st_mtime &&
+	    priv->size == (gint64) buf.st_size) {
+		g_debug ("%s unchanged, not parsing", filename);
+		return TRUE;
+	}
+
+	/* parse again */
+	if (!g_file_get_contents (filename, &data, NULL, error))
+		return FALSE;
+	g_ptr_array_set_size (priv->segments, 0);
+	acb_template_parse (tmpl, data);
+	g_free (priv->filename);
+	priv->filename = g_strdup (filename);
+	priv->mtime = (gint64) buf.st_mtime;
+	priv->size = (gint64) buf.st_size;
+	return TRUE;
+}
+
+void
+acb_template_set_value (AcbTemplate *tmpl, const gchar *key, const gchar *value)
+{
+	AcbTemplatePrivate *priv = GET_PRIVATE (tmpl);
+	g_return_if_fail (ACB_IS_TEMPLATE (tmpl));
+	g_return_if_fail (key != NULL);
+	g_hash_table_insert (priv->values,
+			     g_strdup (key),
+			     g_strdup (value != NULL ? value : ""));
+}
+
+/* unknown variables are left alone, as they might be wanted in the output */
+gchar *
+acb_template_render (AcbTemplate *tmpl)
+{
+	AcbTemplatePrivate *priv = GET_PRIVATE (tmpl);
+	GString *str = g_string_new (NULL);
+	guint i;
+
+	g_return_val_if_fail (ACB_IS_TEMPLATE (tmpl), NULL);
+
+	for (i = 0; i < priv->segments->len; i++) {
+		AcbTemplateSegment *segment = g_ptr_array_index (priv->segments, i);
+		const gchar *value;
+		if (!segment->is_variable) {
+			g_string_append (str, segment->text);
+			continue;
+		}
+		value = g_hash_table_lookup (priv->values, segment->text);
+		if (value == NULL) {
+			g_string_append_printf (str, "#%s#", segment->text);
+			continue;
+		}
+		g_string_append (str, value);
+	}
+	return g_string_free (str, FALSE);
+}
+
+static void
+acb_template_finalize (GObject *object)
+{
+	AcbTemplate *tmpl;
+	AcbTemplatePrivate *priv;
+
+	g_return_if_fail (object != NULL);
+	g_return_if_fail (ACB_IS_TEMPLATE (object));
+	tmpl = ACB_TEMPLATE (object);
+	priv = GET_PRIVATE (tmpl);
+
+	g_free (priv->filename);
+	g_ptr_array_unref (priv->segments);
+	g_hash_table_unref (priv->values);
+
+	G_OBJECT_CLASS (acb_template_parent_class)->finalize (object);
+}
+
+static void
+acb_template_class_init (AcbTemplateClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->finalize = acb_template_finalize;
+}
+
+static void
+acb_template_init (AcbTemplate *tmpl)
+{
+	AcbTemplatePrivate *priv = GET_PRIVATE (tmpl);
+	priv->segments = g_ptr_array_new_with_free_func ((GDestroyNotify) acb_template_segment_free);
+	priv->values = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+}
+
+AcbTemplate *
+acb_template_new (void)
+{
+	AcbTemplate *tmpl;
+	tmpl = g_object_new (ACB_TYPE_TEMPLATE, NULL);
+	return ACB_TEMPLATE (tmpl);
+}
@@ -0,0 +1,48 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2018 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __ACB_TEMPLATE_H
+#define __ACB_TEMPLATE_H
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+#define ACB_TYPE_TEMPLATE (acb_template_get_type ())
+G_DECLARE_DERIVABLE_TYPE (AcbTemplate, acb_template, ACB, TEMPLATE, GObject)
+
+struct _AcbTemplateClass
+{
+	GObjectClass		parent_class;
+};
+
+AcbTemplate	*acb_template_new			(void);
+gboolean	 acb_template_load_file			(AcbTemplate		*tmpl,
+							 const gchar		*filename,
+							 GError			**error);
+void		 acb_template_set_value			(AcbTemplate		*tmpl,
+							 const gchar		*key,
+							 const gchar		*value);
+gchar		*acb_template_render			(AcbTemplate		*tmpl);
+
+G_END_DECLS
+
+#endif /* __ACB_TEMPLATE_H */
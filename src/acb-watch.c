@@ -0,0 +1,385 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2018 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <errno.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <glib.h>
+#include <glib-unix.h>
+#include <glib/gstdio.h>
+
+#include "acb-watch.h"
+
+/* seconds of quiet before a burst of changes starts a build */
+#define ACB_WATCH_DEBOUNCE		5
+
+#define ACB_WATCH_EVENT_MASK		(IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | \
+					 IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR)
+
+typedef enum {
+	ACB_WATCH_KIND_TREE,		/* the working tree */
+	ACB_WATCH_KIND_GIT,		/* only HEAD and packed-refs */
+	ACB_WATCH_KIND_REFS,		/* everything under .git/refs */
+	ACB_WATCH_KIND_LAST
+} AcbWatchKind;
+
+typedef struct {
+	AcbWatch		*watch;
+	AcbProject		*project;
+	guint			 debounce_id;
+	gboolean		 paused;
+} AcbWatchProject;
+
+typedef struct {
+	AcbWatchProject		*item;
+	AcbWatchKind		 kind;
+	gchar			*path;
+} AcbWatchDir;
+
+typedef struct
+{
+	gint			 fd;
+	guint			 source_id;
+	GHashTable		*dirs;		/* wd : AcbWatchDir */
+	GPtrArray		*items;		/* of AcbWatchProject */
+	AcbWatchFunc		 func;
+	gpointer		 user_data;
+} AcbWatchPrivate;
+
+G_DEFINE_TYPE_WITH_PRIVATE (AcbWatch, acb_watch, G_TYPE_OBJECT)
+
+#define GET_PRIVATE(o) (acb_watch_get_instance_private (o))
+
+static void
+acb_watch_project_free (AcbWatchProject *item)
+{
+	if (item->debounce_id != 0)
+		g_source_remove (item->debounce_id);
+	g_object_unref (item->project);
+	g_free (item);
+}
+
+static void
+acb_watch_dir_free (AcbWatchDir *dir)
+{
+	g_free (dir->path);
+	g_free (dir);
+}
+
+/* editor temporary files and build output, which would otherwise loop */
+static gboolean
+acb_watch_name_is_ignored (const gchar *name)
+{
+	const gchar *suffixes[] = { "~", ".o", ".lo", ".la", ".a", ".so",
+				    ".pyc", ".swp", ".tmp", NULL };
+	const gchar *names[] = { "build", "_build", "autom4te.cache",
+				 "__pycache__", "4913", NULL };
+	guint i;
+
+	if (name[0] == '.')
+		return TRUE;
+	for (i = 0; suffixes[i] != NULL; i++) {
+		if (g_str_has_suffix (name, suffixes[i]))
+			return TRUE;
+	}
+	for (i = 0; names[i] != NULL; i++) {
+		if (g_strcmp0 (name, names[i]) == 0)
+			return TRUE;
+	}
+	return FALSE;
+}
+
+/* a fetch only moves the remote-tracking refs, which the tree never uses */
+static gboolean
+acb_watch_name_is_remotes (const gchar *path, const gchar *name)
+{
+	g_autofree gchar *basename = NULL;
+	if (g_strcmp0 (name, "remotes") != 0)
+		return FALSE;
+	basename = g_path_get_basename (path);
+	return g_strcmp0 (basename, "refs") == 0;
+}
+
+static gboolean
+acb_watch_add_dir (AcbWatch *watch,
+		   AcbWatchProject *item,
+		   const gchar *path,
+		   AcbWatchKind kind,
+		   GError **error)
+{
+	AcbWatchPrivate *priv = GET_PRIVATE (watch);
+	AcbWatchDir *dir;
+	const gchar *filename;
+	gint wd;
+	g_autoptr(GDir) gdir = NULL;
+
+	wd = inotify_add_watch (priv->fd, path, ACB_WATCH_EVENT_MASK);
+	if (wd < 0) {
+		if (errno == ENOSPC) {
+			g_set_error (error, 1, 0,
+				     "failed to watch %s: raise fs.inotify.max_user_watches",
+				     path);
+			return FALSE;
+		}
+		g_debug ("failed to watch %s: %s", path, g_strerror (errno));
+		return TRUE;
+	}
+	dir = g_new0 (AcbWatchDir, 1);
+	dir->item = item;
+	dir->kind = kind;
+	dir->path = g_strdup (path);
+	g_hash_table_insert (priv->dirs, GINT_TO_POINTER (wd), dir);
+	if (kind == ACB_WATCH_KIND_GIT)
+		return TRUE;
+
+	/* inotify is not recursive */
+	gdir = g_dir_open (path, 0, NULL);
+	if (gdir == NULL)
+		return TRUE;
+	while ((filename = g_dir_read_name (gdir))) {
+		GStatBuf st;
+		g_autofree gchar *child = NULL;
+		if (kind == ACB_WATCH_KIND_TREE && acb_watch_name_is_ignored (filename))
+			continue;
+		if (kind == ACB_WATCH_KIND_REFS && acb_watch_name_is_remotes (path, filename))
+			continue;
+		child = g_build_filename (path, filename, NULL);
+		if (g_lstat (child, &st) != 0 || !S_ISDIR (st.st_mode))
+			continue;
+		if (!acb_watch_add_dir (watch, item, child, kind, error))
+			return FALSE;
+	}
+	return TRUE;
+}
+
+static gboolean
+acb_watch_debounce_cb (gpointer user_data)
+{
+	AcbWatchProject *item = (AcbWatchProject *) user_data;
+	AcbWatchPrivate *priv = GET_PRIVATE (item->watch);
+
+	item->debounce_id = 0;
+	g_debug ("%s changed", acb_project_get_name (item->project));
+	if (priv->func != NULL)
+		priv->func (item->project, priv->user_data);
+	return G_SOURCE_REMOVE;
+}
+
+static void
+acb_watch_handle_event (AcbWatch *watch, const struct inotify_event *event)
+{
+	AcbWatchPrivate *priv = GET_PRIVATE (watch);
+	AcbWatchDir *dir;
+	const gchar *name = event->len > 0 ? event->name : "";
+
+	dir = g_hash_table_lookup (priv->dirs, GINT_TO_POINTER (event->wd));
+	if (dir == NULL)
+		return;
+	if (event->mask & IN_IGNORED) {
+		g_hash_table_remove (priv->dirs, GINT_TO_POINTER (event->wd));
+		return;
+	}
+
+	/* only some of the files in each kind of directory matter */
+	if (dir->kind == ACB_WATCH_KIND_TREE && acb_watch_name_is_ignored (name))
+		return;
+	if (dir->kind == ACB_WATCH_KIND_GIT &&
+	    g_strcmp0 (name, "HEAD") != 0 &&
+	    g_strcmp0 (name, "packed-refs") != 0)
+		return;
+	if (dir->kind == ACB_WATCH_KIND_REFS && acb_watch_name_is_remotes (dir->path, name))
+		return;
+
+	/* watch any new directories too */
+	if ((event->mask & (IN_CREATE | IN_MOVED_TO)) && (event->mask & IN_ISDIR)) {
+		g_autofree gchar *path = g_build_filename (dir->path, name, NULL);
+		g_autoptr(GError) error = NULL;
+		if (!acb_watch_add_dir (watch, dir->item, path, dir->kind, &error))
+			g_warning ("%s", error->message);
+	}
+
+	/* the build is writing to the tree */
+	if (dir->item->paused)
+		return;
+
+	/* wait for the burst of changes to finish */
+	if (dir->item->debounce_id != 0)
+		g_source_remove (dir->item->debounce_id);
+	dir->item->debounce_id = g_timeout_add_seconds (ACB_WATCH_DEBOUNCE,
+							acb_watch_debounce_cb,
+							dir->item);
+}
+
+static gboolean
+acb_watch_fd_cb (gint fd, GIOCondition condition, gpointer user_data)
+{
+	AcbWatch *watch = ACB_WATCH (user_data);
+	gchar buf[4096] __attribute__ ((aligned (__alignof__ (struct inotify_event))));
+	gssize len;
+
+	for (;;) {
+		gssize offset;
+		len = read (fd, buf, sizeof (buf));
+		if (len <= 0)
+			break;
+		for (offset = 0; offset < len; ) {
+			const struct inotify_event *event = (const struct inotify_event *) (buf + offset);
+			if (event->mask & IN_Q_OVERFLOW)
+				g_warning ("too many changes, some were missed");
+			else
+				acb_watch_handle_event (watch, event);
+			offset += (gssize) (sizeof (struct inotify_event) + event->len);
+		}
+	}
+	return G_SOURCE_CONTINUE;
+}
+
+gboolean
+acb_watch_setup (AcbWatch *watch, GError **error)
+{
+	AcbWatchPrivate *priv = GET_PRIVATE (watch);
+
+	g_return_val_if_fail (ACB_IS_WATCH (watch), FALSE);
+
+	priv->fd = inotify_init1 (IN_NONBLOCK | IN_CLOEXEC);
+	if (priv->fd < 0) {
+		g_set_error (error, 1, 0, "failed to set up inotify: %s",
+			     g_strerror (errno));
+		return FALSE;
+	}
+	priv->source_id = g_unix_fd_add (priv->fd, G_IO_IN, acb_watch_fd_cb, watch);
+	return TRUE;
+}
+
+/* called in the main loop when the project has been quiet for a while */
+void
+acb_watch_set_func (AcbWatch *watch, AcbWatchFunc func, gpointer user_data)
+{
+	AcbWatchPrivate *priv = GET_PRIVATE (watch);
+	g_return_if_fail (ACB_IS_WATCH (watch));
+	priv->func = func;
+	priv->user_data = user_data;
+}
+
+gboolean
+acb_watch_add_project (AcbWatch *watch, AcbProject *project, GError **error)
+{
+	AcbWatchPrivate *priv = GET_PRIVATE (watch);
+	AcbWatchProject *item;
+	const gchar *path;
+	g_autofree gchar *git = NULL;
+	g_autofree gchar *refs = NULL;
+
+	g_return_val_if_fail (ACB_IS_WATCH (watch), FALSE);
+	g_return_val_if_fail (ACB_IS_PROJECT (project), FALSE);
+	g_return_val_if_fail (priv->fd >= 0, FALSE);
+
+	item = g_new0 (AcbWatchProject, 1);
+	item->watch = watch;
+	item->project = g_object_ref (project);
+	g_ptr_array_add (priv->items, item);
+
+	/* a commit only changes the refs */
+	path = acb_project_get_path (project);
+	if (!acb_watch_add_dir (watch, item, path, ACB_WATCH_KIND_TREE, error))
+		return FALSE;
+	git = g_build_filename (path, ".git", NULL);
+	refs = g_build_filename (path, ".git", "refs", NULL);
+	if (g_file_test (refs, G_FILE_TEST_IS_DIR)) {
+		if (!acb_watch_add_dir (watch, item, git, ACB_WATCH_KIND_GIT, error))
+			return FALSE;
+		if (!acb_watch_add_dir (watch, item, refs, ACB_WATCH_KIND_REFS, error))
+			return FALSE;
+	}
+	return TRUE;
+}
+
+/* changes made while the project is being built are its own output */
+void
+acb_watch_set_paused (AcbWatch *watch, AcbProject *project, gboolean paused)
+{
+	AcbWatchPrivate *priv = GET_PRIVATE (watch);
+	guint i;
+
+	g_return_if_fail (ACB_IS_WATCH (watch));
+
+	for (i = 0; i < priv->items->len; i++) {
+		AcbWatchProject *item = g_ptr_array_index (priv->items, i);
+		if (item->project != project)
+			continue;
+		item->paused = paused;
+		if (paused && item->debounce_id != 0) {
+			g_source_remove (item->debounce_id);
+			item->debounce_id = 0;
+		}
+	}
+}
+
+static void
+acb_watch_finalize (GObject *object)
+{
+	AcbWatch *watch;
+	AcbWatchPrivate *priv;
+
+	g_return_if_fail (object != NULL);
+	g_return_if_fail (ACB_IS_WATCH (object));
+	watch = ACB_WATCH (object);
+	priv = GET_PRIVATE (watch);
+
+	if (priv->source_id != 0)
+		g_source_remove (priv->source_id);
+	if (priv->fd >= 0)
+		close (priv->fd);
+	g_hash_table_unref (priv->dirs);
+	g_ptr_array_unref (priv->items);
+
+	G_OBJECT_CLASS (acb_watch_parent_class)->finalize (object);
+}
+
+static void
+acb_watch_class_init (AcbWatchClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->finalize = acb_watch_finalize;
+}
+
+static void
+acb_watch_init (AcbWatch *watch)
+{
+	AcbWatchPrivate *priv = GET_PRIVATE (watch);
+	priv->fd = -1;
+	priv->dirs = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+					    NULL, (GDestroyNotify) acb_watch_dir_free);
+	priv->items = g_ptr_array_new_with_free_func ((GDestroyNotify) acb_watch_project_free);
+}
+
+AcbWatch *
+acb_watch_new (void)
+{
+	AcbWatch *watch;
+	watch = g_object_new (ACB_TYPE_WATCH, NULL);
+	return ACB_WATCH (watch);
+}
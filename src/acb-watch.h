@@ -0,0 +1,57 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2018 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __ACB_WATCH_H
+#define __ACB_WATCH_H
+
+#include <glib-object.h>
+
+#include "acb-project.h"
+
+G_BEGIN_DECLS
+
+#define ACB_TYPE_WATCH (acb_watch_get_type ())
+G_DECLARE_DERIVABLE_TYPE (AcbWatch, acb_watch, ACB, WATCH, GObject)
+
+struct _AcbWatchClass
+{
+	GObjectClass		parent_class;
+};
+
+typedef void	 (*AcbWatchFunc)			(AcbProject		*project,
+							 gpointer		 user_data);
+
+AcbWatch	*acb_watch_new				(void);
+gboolean	 acb_watch_setup			(AcbWatch		*watch,
+							 GError			**error);
+void		 acb_watch_set_func			(AcbWatch		*watch,
+							 AcbWatchFunc		 func,
+							 gpointer		 user_data);
+gboolean	 acb_watch_add_project			(AcbWatch		*watch,
+							 AcbProject		*project,
+							 GError			**error);
+void		 acb_watch_set_paused			(AcbWatch		*watch,
+							 AcbProject		*project,
+							 gboolean		 paused);
+
+G_END_DECLS
+
+#endif /* __ACB_WATCH_H */